@@ -0,0 +1,73 @@
+#include <core/bam.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace core
+{
+    namespace
+    {
+        // the middle of a fine angle, which halves the error of looking it up
+        double fine_angle_radians(const int fine_angle)
+        {
+            return (static_cast<double>(fine_angle) + 0.5) * 2.0 * std::numbers::pi / fine_angles;
+        }
+
+        // the index of the slope num / den into tan_to_angle, num is at most den
+        size_t slope_div(const real num, const real den)
+        {
+            if (den == 0) return slope_range;
+
+            return std::min(static_cast<size_t>(num / den * slope_range), size_t{slope_range});
+        }
+    }
+
+    const std::array<real, fine_angles + fine_angles / 4> fine_sines = [] {
+        auto result = std::array<real, fine_angles + fine_angles / 4>();
+        for (size_t i = 0; i < result.size(); ++i)
+            result[i] = static_cast<real>(std::sin(fine_angle_radians(static_cast<int>(i))));
+        return result;
+    }();
+
+    const std::array<real, fine_angles / 2> fine_tangents = [] {
+        auto result = std::array<real, fine_angles / 2>();
+        for (size_t i = 0; i < result.size(); ++i)
+            result[i] = static_cast<real>(std::tan(fine_angle_radians(static_cast<int>(i) - fine_angles / 4)));
+        return result;
+    }();
+
+    const std::array<bam, slope_range + 1> tan_to_angle = [] {
+        auto result = std::array<bam, slope_range + 1>();
+        for (size_t i = 0; i < result.size(); ++i)
+        {
+            const auto angle = std::atan(static_cast<double>(i) / slope_range);
+            result[i] = bam::from_raw(static_cast<std::uint32_t>(angle / (2.0 * std::numbers::pi) * 4294967296.0));
+        }
+        return result;
+    }();
+
+    bam point_to_bam(real x, real y)
+    {
+        if ((x == 0) && (y == 0)) return {};
+
+        const auto angle = [](const real num, const real den) { return tan_to_angle[slope_div(num, den)]; };
+        constexpr auto just_below_90 = ang90 - bam::from_raw(1);
+        constexpr auto just_below_180 = ang180 - bam::from_raw(1);
+        constexpr auto just_below_270 = ang270 - bam::from_raw(1);
+
+        // fold the direction into the first octant and unfold its angle again
+        if (x >= 0)
+        {
+            if (y >= 0) return (x > y) ? angle(y, x) : just_below_90 - angle(x, y);
+
+            y = -y;
+            return (x > y) ? -angle(y, x) : ang270 + angle(x, y);
+        }
+
+        x = -x;
+        if (y >= 0) return (x > y) ? just_below_180 - angle(y, x) : ang90 + angle(x, y);
+
+        y = -y;
+        return (x > y) ? ang180 + angle(y, x) : just_below_270 - angle(x, y);
+    }
+}
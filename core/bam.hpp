@@ -0,0 +1,106 @@
+#pragma once
+
+#include <core/radians.hpp>
+#include <core/real.hpp>
+
+#include <array>
+#include <compare>
+#include <cstdint>
+#include <numbers>
+
+namespace core
+{
+    // A binary angle: a full turn is 2^32, so adding angles wraps around at 360° by overflowing, just like
+    // the original's angle_t. Its trigonometry looks up the fine angle tables below.
+    class bam
+    {
+    public:
+        static constexpr auto fine_shift = 19;
+
+        constexpr bam() = default;
+        explicit bam(const radians x)
+            : raw_(static_cast<std::uint32_t>(static_cast<std::int64_t>(static_cast<double>(to_fraction(x)) * turn)))
+        {
+        }
+
+        [[nodiscard]] static constexpr bam from_raw(const std::uint32_t raw)
+        {
+            auto result = bam();
+            result.raw_ = raw;
+            return result;
+        }
+
+        [[nodiscard]] constexpr std::uint32_t raw_value() const { return raw_; }
+
+        // the index of the fine angle the angle falls into
+        [[nodiscard]] constexpr std::uint32_t fine_index() const { return raw_ >> fine_shift; }
+
+        [[nodiscard]] radians to_radians() const
+        {
+            return radians(static_cast<double>(raw_) / turn * 2.0 * std::numbers::pi);
+        }
+
+        constexpr auto operator<=>(const bam&) const = default;
+
+        [[nodiscard]] constexpr bam operator-() const { return from_raw(0U - raw_); }
+
+        constexpr bam& operator+=(const bam x)
+        {
+            raw_ += x.raw_;
+            return *this;
+        }
+
+        constexpr bam& operator-=(const bam x)
+        {
+            raw_ -= x.raw_;
+            return *this;
+        }
+
+    private:
+        static constexpr auto turn = 4294967296.0;
+
+        std::uint32_t raw_ = 0;
+    };
+
+    [[nodiscard]] constexpr bam operator+(const bam x, const bam y)
+    {
+        auto result = x;
+        result += y;
+        return result;
+    }
+
+    [[nodiscard]] constexpr bam operator-(const bam x, const bam y)
+    {
+        auto result = x;
+        result -= y;
+        return result;
+    }
+
+    constexpr auto ang90 = bam::from_raw(0x40000000U);
+    constexpr auto ang180 = bam::from_raw(0x80000000U);
+    constexpr auto ang270 = bam::from_raw(0xc0000000U);
+
+    constexpr auto fine_angles = 1 << (32 - bam::fine_shift);
+    constexpr auto slope_range = 2048;
+
+    // The sines of all fine angles and a quarter turn more, so the cosines are in there too
+    extern const std::array<real, fine_angles + fine_angles / 4> fine_sines;
+
+    // The tangents of the fine angles from -90° up to 90°
+    extern const std::array<real, fine_angles / 2> fine_tangents;
+
+    // The angles of the slopes from 0 to 1 in steps of 1 / slope_range
+    extern const std::array<bam, slope_range + 1> tan_to_angle;
+
+    [[nodiscard]] inline real sin(const bam x) { return fine_sines[x.fine_index()]; }
+
+    [[nodiscard]] inline real cos(const bam x) { return fine_sines[x.fine_index() + fine_angles / 4]; }
+
+    [[nodiscard]] inline real tan(const bam x)
+    {
+        return fine_tangents[(x + ang90).fine_index() & (fine_angles / 2 - 1)];
+    }
+
+    // The angle of the direction (x, y), worked out from tan_to_angle like R_PointToAngle did
+    [[nodiscard]] bam point_to_bam(real x, real y);
+}
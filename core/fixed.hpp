@@ -0,0 +1,120 @@
+#pragma once
+
+#include <compare>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+
+namespace core
+{
+    // A 16.16 fixed point number, the way the original engine did its arithmetic. Like the original,
+    // multiplications wrap on overflow and divisions saturate.
+    class fixed
+    {
+    public:
+        static constexpr auto fraction_bits = 16;
+        static constexpr auto one = std::int32_t{1} << fraction_bits;
+
+        constexpr fixed() = default;
+        constexpr explicit fixed(const std::floating_point auto x)
+            : raw_(static_cast<std::int32_t>(static_cast<std::int64_t>(x * one)))
+        {
+        }
+        constexpr explicit fixed(const std::integral auto x)
+            : raw_(static_cast<std::int32_t>(static_cast<std::uint32_t>(x) << fraction_bits))
+        {
+        }
+
+        [[nodiscard]] static constexpr fixed from_raw(const std::int32_t raw)
+        {
+            auto result = fixed();
+            result.raw_ = raw;
+            return result;
+        }
+
+        [[nodiscard]] constexpr std::int32_t raw_value() const { return raw_; }
+
+        constexpr auto operator<=>(const fixed&) const = default;
+
+        template <std::floating_point T>
+        constexpr explicit operator T() const noexcept
+        {
+            return static_cast<T>(raw_) / static_cast<T>(one);
+        }
+
+        // rounds down rather than towards zero
+        template <std::integral T>
+        constexpr explicit operator T() const noexcept
+        {
+            return static_cast<T>(raw_ >> fraction_bits);
+        }
+
+        [[nodiscard]] constexpr fixed operator-() const { return from_raw(-raw_); }
+
+        constexpr fixed& operator+=(const fixed x)
+        {
+            raw_ += x.raw_;
+            return *this;
+        }
+
+        constexpr fixed& operator-=(const fixed x)
+        {
+            raw_ -= x.raw_;
+            return *this;
+        }
+
+        constexpr fixed& operator*=(const fixed x)
+        {
+            raw_ = static_cast<std::int32_t>((std::int64_t{raw_} * x.raw_) >> fraction_bits);
+            return *this;
+        }
+
+        constexpr fixed& operator/=(const fixed x)
+        {
+            // in 64 bits, the magnitude of the smallest 32 bit number doesn't fit into 32 bits
+            const auto magnitude = [](const std::int64_t i) { return (i < 0) ? -i : i; };
+            if ((magnitude(raw_) >> 14) >= magnitude(x.raw_))
+            {
+                raw_ = ((raw_ ^ x.raw_) < 0) ? std::numeric_limits<std::int32_t>::min()
+                                             : std::numeric_limits<std::int32_t>::max();
+            }
+            else
+            {
+                raw_ = static_cast<std::int32_t>((std::int64_t{raw_} << fraction_bits) / x.raw_);
+            }
+
+            return *this;
+        }
+
+    private:
+        std::int32_t raw_ = 0;
+    };
+
+    [[nodiscard]] constexpr fixed operator+(const fixed x, const fixed y)
+    {
+        auto result = x;
+        result += y;
+        return result;
+    }
+
+    [[nodiscard]] constexpr fixed operator-(const fixed x, const fixed y)
+    {
+        auto result = x;
+        result -= y;
+        return result;
+    }
+
+    [[nodiscard]] constexpr fixed operator*(const fixed x, const fixed y)
+    {
+        auto result = x;
+        result *= y;
+        return result;
+    }
+
+    [[nodiscard]] constexpr fixed operator/(const fixed x, const fixed y)
+    {
+        auto result = x;
+        result /= y;
+        return result;
+    }
+}
@@ -1,11 +1,16 @@
 #include <core/game_data.hpp>
 
+#include <core/thread_pool.hpp>
 #include <core/wad_types.hpp>
 
+#include <unistd.h>
+
 namespace core
 {
     namespace
     {
+        using namespace literals;
+
         // clang-format off
         constexpr auto iwads = std::array{
                 iwad_description{.name = "doom.wad", .mission = game_mission::doom, .mode = game_mode::retail, .description = "Doom"},
@@ -13,37 +18,223 @@ namespace core
                 iwad_description{.name = "doom2.wad", .mission = game_mission::doom2, .mode = game_mode::commercial, .description = "Doom II"},
         };
         // clang-format on
+
+        void check_wad_id(const wad_header& header, const std::filesystem::path& wad_path)
+        {
+            const auto id = std::string_view(header.identification.data(), 4);
+            if ((id != "IWAD") and (id != "PWAD"))
+            {
+                throw std::invalid_argument(
+                    fmt::format("Wad file {} doesn't have IWAD or PWAD id\n", wad_path.string()));
+            }
+        }
+
+        struct namespace_marker
+        {
+            lump_key start;
+            lump_key end;
+            lump_namespace ns;
+        };
+
+        constexpr auto namespace_markers = std::array{
+            namespace_marker{.start = "F_START"_lump, .end = "F_END"_lump, .ns = lump_namespace::flats},
+            namespace_marker{.start = "FF_START"_lump, .end = "FF_END"_lump, .ns = lump_namespace::flats},
+            namespace_marker{.start = "S_START"_lump, .end = "S_END"_lump, .ns = lump_namespace::sprites},
+            namespace_marker{.start = "SS_START"_lump, .end = "SS_END"_lump, .ns = lump_namespace::sprites},
+            namespace_marker{.start = "P_START"_lump, .end = "P_END"_lump, .ns = lump_namespace::patches},
+            namespace_marker{.start = "PP_START"_lump, .end = "PP_END"_lump, .ns = lump_namespace::patches},
+        };
+
+        constexpr auto things_lump = "THINGS"_lump;
+
+        auto& lump_table(core::game_data& data, const lump_namespace ns)
+        {
+            return data.lump_tables[static_cast<size_t>(ns)];
+        }
+
+        void index_lumps(const size_t first_lump, core::game_data& data)
+        {
+            const auto lumps = std::span(data.lumps).subspan(first_lump);
+            lump_table(data, lump_namespace::global).reserve(data.lumps.size());
+
+            // namespaces never extend beyond the end of a file
+            auto current_ns = lump_namespace::global;
+            for (auto i = first_lump; const auto& lump : lumps)
+            {
+                const auto num = i++;
+                lump_table(data, lump_namespace::global).insert_or_assign(lump.name, num);
+
+                if (const auto* marker = std::ranges::find(namespace_markers, lump.name, &namespace_marker::start);
+                    marker != namespace_markers.end())
+                {
+                    current_ns = marker->ns;
+                }
+                else if (std::ranges::find(namespace_markers, lump.name, &namespace_marker::end)
+                         != namespace_markers.end())
+                {
+                    current_ns = lump_namespace::global;
+                }
+                else if ((current_ns != lump_namespace::global) && (lump.size > 0))
+                {
+                    // zero sized lumps inside a namespace are sub-markers like F1_START
+                    lump_table(data, current_ns).insert_or_assign(lump.name, num);
+                }
+
+                // a map label is the lump directly in front of the map's THINGS
+                if ((num + 1 < data.lumps.size()) && (data.lumps[num + 1].name == things_lump))
+                    lump_table(data, lump_namespace::maps).insert_or_assign(lump.name, num);
+            }
+        }
+
+        void add_lumps(const std::span<const wad_lump_descriptor> lump_descriptors, FILE* wad_file,
+                       const std::byte* mapping, core::game_data& data)
+        {
+            const auto first_lump = data.lumps.size();
+            data.lumps.reserve(data.lumps.size() + lump_descriptors.size());
+            std::ranges::transform(lump_descriptors, std::back_inserter(data.lumps), [&](const auto& descriptor) {
+                return lump_info{.name = lump_key(descriptor.name),
+                                 .wad_file = wad_file,
+                                 .mapped = (mapping != nullptr) ? mapping + descriptor.file_pos : nullptr,
+                                 .position = descriptor.file_pos,
+                                 .size = descriptor.size};
+            });
+
+            data.cache.add_lumps(lump_descriptors.size());
+            index_lumps(first_lump, data);
+        }
+
+        void add_mapped_wad_file(const std::filesystem::path& wad_path, mapped_file file, core::game_data& data)
+        {
+            const auto bytes = file.bytes();
+            const auto is_in_file = [&](const size_t offset, const size_t size) {
+                return (offset <= bytes.size()) && (size <= bytes.size() - offset);
+            };
+
+            if (!is_in_file(0, sizeof(wad_header)))
+                throw std::invalid_argument(fmt::format("Wad file {} is too small", wad_path.string()));
+
+            wad_header header;
+            memcpy(&header, bytes.data(), sizeof(wad_header));
+            check_wad_id(header, wad_path);
+
+            const auto num_lumps = static_cast<size_t>(header.num_lumps);
+            const auto info_table_offset = static_cast<size_t>(header.info_table_offset);
+            if (!is_in_file(info_table_offset, num_lumps * sizeof(wad_lump_descriptor)))
+            {
+                throw std::invalid_argument(
+                    fmt::format("Wad file {} has a truncated lump directory", wad_path.string()));
+            }
+
+            auto lump_descriptors = std::vector<wad_lump_descriptor>(num_lumps);
+            memcpy(lump_descriptors.data(), bytes.data() + info_table_offset, num_lumps * sizeof(wad_lump_descriptor));
+
+            const auto is_truncated = [&](const wad_lump_descriptor& d) {
+                return !is_in_file(static_cast<size_t>(d.file_pos), static_cast<size_t>(d.size));
+            };
+            if (std::ranges::any_of(lump_descriptors, is_truncated))
+                throw std::invalid_argument(fmt::format("Wad file {} has lumps beyond its end", wad_path.string()));
+
+            add_lumps(lump_descriptors, nullptr, bytes.data(), data);
+
+            data.mapped_wad_files.emplace_back(std::move(file));
+            data.wad_paths.push_back(wad_path);
+        }
+
+        void add_stdio_wad_file(const std::filesystem::path& wad_path, core::game_data& data)
+        {
+            auto wad_file = std::unique_ptr<FILE, decltype(&fclose)>(fopen(wad_path.string().c_str(), "rbe"), &fclose);
+            if (!wad_file) throw std::invalid_argument(fmt::format(" couldn't open {}", wad_path.string()));
+
+            wad_header header;
+            fread(&header, sizeof(wad_header), 1, wad_file.get());
+            check_wad_id(header, wad_path);
+
+            auto lump_descriptors = std::vector<wad_lump_descriptor>(header.num_lumps);
+            fseek(wad_file.get(), header.info_table_offset, SEEK_SET);
+            fread(lump_descriptors.data(), sizeof(wad_lump_descriptor), header.num_lumps, wad_file.get());
+
+            add_lumps(lump_descriptors, wad_file.get(), nullptr, data);
+
+            data.wad_files.emplace_back(std::move(wad_file));
+            data.wad_paths.push_back(wad_path);
+        }
+    }
+
+    void add_wad_file(const std::filesystem::path& wad_path, core::game_data& data, const wad_backend backend)
+    {
+        fmt::print(" adding {}\n", wad_path.string());
+
+        if (backend == wad_backend::mapped)
+        {
+            if (auto file = map_file(wad_path))
+            {
+                add_mapped_wad_file(wad_path, std::move(*file), data);
+                return;
+            }
+        }
+
+        add_stdio_wad_file(wad_path, data);
     }
 
-    void add_wad_file(const std::filesystem::path& iwad_path, core::game_data& data)
+    const std::byte* read_lump(core::game_data& data, const size_t num, const purge_tag tag)
     {
-        fmt::print(" adding {}\n", iwad_path.string());
-
-        auto wad_file = std::unique_ptr<FILE, decltype(&fclose)>(fopen(iwad_path.string().c_str(), "rbe"), &fclose);
-        if (!wad_file) throw std::invalid_argument(fmt::format(" couldn't open {}", iwad_path.string()));
-
-        wad_header header;
-        fread(&header, sizeof(wad_header), 1, wad_file.get());
-        const auto id = std::string_view(header.identification.data(), 4);
-        if ((id != "IWAD") and (id != "PWAD"))
-            throw std::invalid_argument(fmt::format("Wad file {} doesn't have IWAD or PWAD id\n", iwad_path.string()));
-
-        auto lump_descriptors = std::vector<wad_lump_descriptor>(header.num_lumps);
-        fseek(wad_file.get(), header.info_table_offset, SEEK_SET);
-        fread(lump_descriptors.data(), sizeof(wad_lump_descriptor), header.num_lumps, wad_file.get());
-
-        data.lumps.reserve(data.lumps.size() + lump_descriptors.size());
-        std::ranges::transform(lump_descriptors, std::back_inserter(data.lumps), [&](const auto& descriptor) {
-            return lump_info{.name = array_to_string(descriptor.name),
-                             .wad_file = wad_file.get(),
-                             .position = descriptor.file_pos,
-                             .size = descriptor.size};
+        const auto& lump = data.lumps[num];
+        const auto size = static_cast<size_t>(lump.size);
+        if (size == 0) return nullptr;
+
+        return data.cache.fill(num, size, tag, [&](std::byte* buffer) {
+            if (lump.mapped != nullptr)
+            {
+                std::memcpy(buffer, lump.mapped, size);
+                return;
+            }
+
+            // pread doesn't move a shared file position, so different lumps can be read concurrently
+            for (size_t n = 0; n < size;)
+            {
+                const auto result = pread(fileno(lump.wad_file), buffer + n, size - n, lump.position + n);
+                if (result <= 0)
+                {
+                    throw std::runtime_error(
+                        fmt::format("Failed to read lump '{}' ({})", lump.name.to_string(), num));
+                }
+
+                n += static_cast<size_t>(result);
+            }
         });
+    }
+
+    void preload_lump(core::game_data& data, const size_t num, const purge_tag tag)
+    {
+        const auto& lump = data.lumps[num];
+        if (lump.mapped == nullptr)
+        {
+            cache_lump_num<std::byte>(data, num, tag);
+            return;
+        }
 
-        for (auto i = 0; const auto& lump : data.lumps)
-            data.lump_table[lump.name] = i++;
+        // touching one byte per page is enough to fault the whole lump in
+        constexpr auto page_size = size_t{4096};
+        auto sum = 0U;
+        for (size_t i = 0; i < static_cast<size_t>(lump.size); i += page_size)
+            sum += static_cast<unsigned>(lump.mapped[i]);
 
-        data.wad_files.emplace_back(std::move(wad_file));
+        [[maybe_unused]] const volatile auto sink = sum;
+    }
+
+    std::future<void> prefetch_lumps(core::thread_pool& pool, core::game_data& data, std::vector<size_t> lump_nums)
+    {
+        return pool.submit([&data, nums = std::move(lump_nums)] {
+            for (const auto num : nums)
+                preload_lump(data, num, purge_tag::purgeable);
+        });
+    }
+
+    void add_wad_files(const std::span<const std::filesystem::path> wad_paths, core::game_data& data,
+                       const wad_backend backend)
+    {
+        for (const auto& path : wad_paths)
+            add_wad_file(path, data, backend);
     }
 
     std::pair<std::filesystem::path, iwad_description> find_iwad()
@@ -1,14 +1,24 @@
 #pragma once
 
+#include <core/lump_cache.hpp>
+#include <core/lump_index.hpp>
+#include <core/mapped_file.hpp>
+
 #include <fmt/format.h>
 
+#include <algorithm>
 #include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <filesystem>
+#include <future>
 #include <memory>
 #include <span>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <vector>
 
 namespace core
 {
@@ -53,9 +63,25 @@ namespace core
         blockmap,     // LUT, motion clipping, walls/grid element
     };
 
+    // Lumps between the F_START/F_END, S_START/S_END and P_START/P_END markers (or their FF_, SS_
+    // and PP_ variants in PWADs) and map labels are also indexed in a namespace of their own, so
+    // looking up e.g. a flat can't find a sprite or a map lump that happens to have the same name.
+    // Every lump is in the global namespace.
+    enum class lump_namespace : size_t
+    {
+        global,
+        flats,
+        sprites,
+        patches,
+        maps
+    };
+
+    constexpr auto num_lump_namespaces = static_cast<size_t>(lump_namespace::maps) + 1;
+
     struct configuration
     {
         std::string dir;
+        size_t lump_cache_budget = lump_cache::unlimited;  // bytes of lumps read from stdio wads kept in memory
     };
 
     struct iwad_description
@@ -66,20 +92,33 @@ namespace core
         std::string_view description;
     };
 
+    class thread_pool;
+
+    // How the contents of a wad file are made available. Mapped wads hand out pointers straight into
+    // the file mapping, stdio wads read each lump into the game_data's lump_cache the first time it is used.
+    enum class wad_backend
+    {
+        mapped,
+        stdio
+    };
+
     struct lump_info
     {
-        std::string name;
-        FILE* wad_file;
-        int position;
-        int size;
-        std::vector<std::byte> cache;
+        lump_key name;
+        FILE* wad_file = nullptr;
+        const std::byte* mapped = nullptr;  // start of the lump in the file mapping (null for stdio wads)
+        int position = 0;
+        int size = 0;
     };
 
     struct game_data
     {
         std::vector<std::unique_ptr<FILE, decltype(&fclose)>> wad_files;
+        std::vector<mapped_file> mapped_wad_files;
+        std::vector<std::filesystem::path> wad_paths;  // in the order the wads were added
         std::vector<lump_info> lumps;
-        std::unordered_map<std::string, size_t> lump_table;
+        std::array<lump_index, num_lump_namespaces> lump_tables;
+        lump_cache cache;
     };
 
     inline int lump_size(const core::game_data& data, const size_t num)
@@ -90,43 +129,59 @@ namespace core
         return data.lumps[num].size;
     }
 
+    // The miss path of cache_lump_num for lumps in stdio wads and misaligned lumps in mapped wads
+    const std::byte* read_lump(core::game_data& data, const size_t num, const purge_tag tag);
+
+    // Safe to call from several threads at once, as long as no wads are added at the same time. The tag
+    // decides when a lump that had to be copied may be evicted from the cache again (see lump_cache). Lumps
+    // in mapped wads are only copied if they don't start at an address aligned for DataType, which wads
+    // don't promise, otherwise they don't count towards the cache budget.
     template <typename DataType>
-    const DataType* cache_lump_num(core::game_data& data, const size_t num)
+    const DataType* cache_lump_num(core::game_data& data, const size_t num,
+                                   const purge_tag tag = purge_tag::permanent)
     {
-        auto& lump = data.lumps[num];
-        if (lump.cache.empty())
-        {
-            lump.cache.resize(lump.size);
+        const auto& lump = data.lumps[num];
+        if ((lump.mapped != nullptr) && (reinterpret_cast<std::uintptr_t>(lump.mapped) % alignof(DataType) == 0))
+            return reinterpret_cast<const DataType*>(lump.mapped);
 
-            fseek(lump.wad_file, lump.position, SEEK_SET);
-            fread(lump.cache.data(), lump.size, 1, lump.wad_file);
-        }
+        const auto* cached = data.cache.find(num, tag);
+        return reinterpret_cast<const DataType*>((cached != nullptr) ? cached : read_lump(data, num, tag));
+    }
 
-        return reinterpret_cast<DataType*>(lump.cache.data());
+    // When several lumps in the same namespace have the same name, the one added last wins
+    inline std::optional<size_t> find_lump_num(const core::game_data& data, const lump_key name,
+                                               const lump_namespace ns = lump_namespace::global)
+    {
+        return data.lump_tables[static_cast<size_t>(ns)].find(name);
     }
 
-    template <typename DataType>
-    const DataType* cache_lump(core::game_data& data, const std::string_view name)
+    inline size_t lump_num(const core::game_data& data, const lump_key name,
+                           const lump_namespace ns = lump_namespace::global)
     {
-        const auto it = data.lump_table.find(std::string(name));  // todo avoid string construction here
-        if (it == data.lump_table.end()) throw std::runtime_error(fmt::format("Lump '{}' could not be found", name));
+        const auto num = find_lump_num(data, name, ns);
+        if (!num) throw std::runtime_error(fmt::format("Lump '{}' could not be found", name.to_string()));
 
-        return cache_lump_num<DataType>(data, it->second);
+        return *num;
     }
 
     template <typename DataType>
-    std::span<const DataType> cache_lump_num_as_span(core::game_data& data, const size_t num)
+    const DataType* cache_lump(core::game_data& data, const lump_key name, const purge_tag tag = purge_tag::permanent)
     {
-        return {cache_lump_num<DataType>(data, num), lump_size(data, num) / sizeof(DataType)};
+        return cache_lump_num<DataType>(data, lump_num(data, name), tag);
     }
 
     template <typename DataType>
-    std::span<const DataType> cache_lump_as_span(core::game_data& data, const std::string_view name)
+    std::span<const DataType> cache_lump_num_as_span(core::game_data& data, const size_t num,
+                                                     const purge_tag tag = purge_tag::permanent)
     {
-        const auto it = data.lump_table.find(std::string(name));  // todo avoid string construction here
-        if (it == data.lump_table.end()) throw std::runtime_error(fmt::format("Lump '{}' could not be found", name));
+        return {cache_lump_num<DataType>(data, num, tag), lump_size(data, num) / sizeof(DataType)};
+    }
 
-        return cache_lump_num_as_span<DataType>(data, it->second);
+    template <typename DataType>
+    std::span<const DataType> cache_lump_as_span(core::game_data& data, const lump_key name,
+                                                 const purge_tag tag = purge_tag::permanent)
+    {
+        return cache_lump_num_as_span<DataType>(data, lump_num(data, name), tag);
     }
 
     template <size_t N>
@@ -141,10 +196,14 @@ namespace core
     class lump_byte_stream
     {
     public:
-        lump_byte_stream(core::game_data& data, const std::string_view name) : bytes_(cache_lump<std::byte>(data, name))
+        lump_byte_stream(core::game_data& data, const lump_key name, const purge_tag tag = purge_tag::permanent)
+            : bytes_(cache_lump<std::byte>(data, name, tag))
+        {
+        }
+        lump_byte_stream(core::game_data& data, const size_t num, const purge_tag tag = purge_tag::permanent)
+            : bytes_(cache_lump_num<std::byte>(data, num, tag))
         {
         }
-        lump_byte_stream(core::game_data& data, const size_t num) : bytes_(cache_lump_num<std::byte>(data, num)) {}
 
         template <typename T>
         T read()
@@ -174,7 +233,22 @@ namespace core
         std::size_t pos_ = 0;
     };
 
-    void add_wad_file(const std::filesystem::path& iwad_path, core::game_data& data);
+    // Only the lumps of the added file are indexed, so mounting a stack of wads costs time proportional
+    // to the total number of lumps. Falls back to the stdio backend if a wad can't be mapped.
+    void add_wad_file(const std::filesystem::path& wad_path, core::game_data& data,
+                      const wad_backend backend = wad_backend::mapped);
+
+    // Brings a lump into memory on the calling thread. For mapped wads this faults in the lump's pages.
+    void preload_lump(core::game_data& data, const size_t num, const purge_tag tag);
+
+    // Brings the given lumps into memory on a worker thread, so that later cache_lump_num calls for them
+    // don't have to wait for the disk. For mapped wads this faults in the lumps' pages, lumps from stdio
+    // wads are cached as purgeable until they are used with a stronger tag.
+    std::future<void> prefetch_lumps(core::thread_pool& pool, core::game_data& data, std::vector<size_t> lump_nums);
+
+    // Mounts the wads in order, so lumps in later files override lumps in earlier ones
+    void add_wad_files(const std::span<const std::filesystem::path> wad_paths, core::game_data& data,
+                       const wad_backend backend = wad_backend::mapped);
 
     std::pair<std::filesystem::path, iwad_description> find_iwad();
 }
\ No newline at end of file
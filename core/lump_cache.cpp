@@ -0,0 +1,139 @@
+#include <core/lump_cache.hpp>
+
+#include <fmt/format.h>
+
+#include <stdexcept>
+
+namespace core
+{
+    void lump_cache::purge_level()
+    {
+        const auto lock = std::lock_guard(mutex_);
+        for (size_t num = 0; num < slots_.size(); ++num)
+        {
+            auto& tag = slots_[num].tag;
+            if ((slots_[num].data.load(std::memory_order_relaxed) != nullptr) &&
+                (tag.load(std::memory_order_relaxed) == purge_tag::level))
+            {
+                tag.store(purge_tag::purgeable, std::memory_order_relaxed);
+                add_lru_candidate(num);
+            }
+        }
+    }
+
+    void lump_cache::release_evicted()
+    {
+        auto retired = std::vector<std::unique_ptr<std::byte[]>>();
+        {
+            const auto lock = std::lock_guard(mutex_);
+            retired.swap(retired_);
+            retired_.swap(evicted_);
+        }
+
+        epoch_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void lump_cache::set_budget(const size_t bytes)
+    {
+        const auto lock = std::lock_guard(mutex_);
+        budget_ = bytes;
+
+        evict_until_fits(0);
+    }
+
+    size_t lump_cache::budget() const
+    {
+        const auto lock = std::lock_guard(mutex_);
+        return budget_;
+    }
+
+    size_t lump_cache::resident_bytes() const
+    {
+        const auto lock = std::lock_guard(mutex_);
+        return resident_bytes_;
+    }
+
+    const std::byte* lump_cache::use_resident(slot_t& slot, const purge_tag tag)
+    {
+        const auto lock = std::lock_guard(mutex_);
+        const auto* data = slot.data.load(std::memory_order_relaxed);
+        if (data == nullptr) return nullptr;
+
+        if (slot.tag.load(std::memory_order_relaxed) < tag) slot.tag.store(tag, std::memory_order_relaxed);
+        slot.last_used.store(epoch_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        return data;
+    }
+
+    void lump_cache::reserve(const size_t size)
+    {
+        const auto lock = std::lock_guard(mutex_);
+        evict_until_fits(size);
+        resident_bytes_ += size;
+    }
+
+    void lump_cache::unreserve(const size_t size)
+    {
+        const auto lock = std::lock_guard(mutex_);
+        resident_bytes_ -= size;
+    }
+
+    const std::byte* lump_cache::publish(const size_t num, const size_t size, const purge_tag tag,
+                                         std::unique_ptr<std::byte[]> storage)
+    {
+        const auto lock = std::lock_guard(mutex_);
+        auto& slot = slots_[num];
+        slot.size = size;
+        slot.storage = std::move(storage);
+        slot.tag.store(tag, std::memory_order_relaxed);
+        slot.last_used.store(epoch_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        slot.data.store(slot.storage.get(), std::memory_order_release);
+        if (tag == purge_tag::purgeable) add_lru_candidate(num);
+
+        return slot.storage.get();
+    }
+
+    void lump_cache::evict_until_fits(const size_t size)
+    {
+        while ((resident_bytes_ > budget_) || (size > budget_ - resident_bytes_))
+        {
+            if (lru_.empty())
+            {
+                throw std::runtime_error(fmt::format("Lump cache budget of {} bytes exceeded ({} bytes resident, "
+                                                     "{} bytes requested)",
+                                                     budget_, resident_bytes_, size));
+            }
+
+            const auto [last_used, num] = lru_.top();
+            lru_.pop();
+
+            // lumps that were evicted or got a stronger tag since they were pushed aren't candidates any more,
+            // lumps that were used since go back in with the time they were last used
+            auto& slot = slots_[num];
+            slot.is_lru_candidate = false;
+            if ((slot.data.load(std::memory_order_relaxed) == nullptr) ||
+                (slot.tag.load(std::memory_order_relaxed) != purge_tag::purgeable))
+            {
+                continue;
+            }
+
+            if (slot.last_used.load(std::memory_order_relaxed) != last_used)
+            {
+                add_lru_candidate(num);
+                continue;
+            }
+
+            slot.data.store(nullptr, std::memory_order_relaxed);
+            evicted_.push_back(std::move(slot.storage));
+            resident_bytes_ -= slot.size;
+        }
+    }
+
+    void lump_cache::add_lru_candidate(const size_t num)
+    {
+        auto& slot = slots_[num];
+        if (slot.is_lru_candidate) return;
+
+        slot.is_lru_candidate = true;
+        lru_.emplace(slot.last_used.load(std::memory_order_relaxed), num);
+    }
+}
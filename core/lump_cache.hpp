@@ -0,0 +1,145 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+namespace core
+{
+    // The equivalents of the original zone allocator's PU_STATIC, PU_LEVEL and PU_CACHE tags, ordered from
+    // the weakest to the strongest. A lump that is requested with several tags keeps the strongest one.
+    enum class purge_tag : std::uint8_t
+    {
+        purgeable,  // can be evicted whenever the cache needs room for another lump
+        level,      // stays until the level it belongs to is purged
+        permanent   // never evicted
+    };
+
+    // Holds the contents of lumps that can't be handed out straight from a file mapping. Finding a lump
+    // that is already resident is a single atomic load. The first thread to miss a lump reads it, any
+    // other thread asking for the same lump meanwhile waits for that read instead of doing its own.
+    //
+    // The memory held by resident lumps is kept under a budget by evicting the least recently used
+    // purgeable lumps. Evicted lumps are simply read again the next time they are needed. Pointers to
+    // evicted lumps stay valid until the second release_evicted call after the eviction, which lets the
+    // draw commands of one frame be rasterized while the next frame is recorded. release_evicted has to be
+    // called at a point where nothing uses lump pointers from before the previous call (e.g. between two
+    // frames).
+    class lump_cache
+    {
+    public:
+        static constexpr auto unlimited = std::numeric_limits<size_t>::max();
+
+        [[nodiscard]] const std::byte* find(const size_t num, const purge_tag tag) const
+        {
+            const auto& slot = slots_[num];
+            const auto* data = slot.data.load(std::memory_order_acquire);
+
+            // changing the tag has to go through fill so it can't race with an eviction
+            if ((data == nullptr) || (slot.tag.load(std::memory_order_relaxed) < tag)) return nullptr;
+
+            if (const auto epoch = epoch_.load(std::memory_order_relaxed);
+                slot.last_used.load(std::memory_order_relaxed) != epoch)
+            {
+                slot.last_used.store(epoch, std::memory_order_relaxed);
+            }
+
+            return data;
+        }
+
+        // read(std::byte*) must fill the buffer it is given with the lump. Throws if the lump doesn't fit
+        // into the budget even after evicting all purgeable lumps.
+        template <typename Read>
+        const std::byte* fill(const size_t num, const size_t size, const purge_tag tag, Read&& read)
+        {
+            auto& slot = slots_[num];
+            const auto fill_lock = std::lock_guard(fill_mutexes_[num % fill_mutexes_.size()]);
+            if (const auto* data = use_resident(slot, tag)) return data;
+
+            reserve(size);
+            auto storage = std::unique_ptr<std::byte[]>();
+            try
+            {
+                storage = std::make_unique_for_overwrite<std::byte[]>(size);
+                read(storage.get());
+            }
+            catch (...)
+            {
+                unreserve(size);
+                throw;
+            }
+
+            return publish(num, size, tag, std::move(storage));
+        }
+
+        // Turns all level lumps into purgeable ones, e.g. when a new level is loaded
+        void purge_level();
+
+        // Frees the memory of the lumps that were evicted before the previous call and starts a new LRU time
+        // step
+        void release_evicted();
+
+        // Evicts purgeable lumps until the resident ones fit. Throws if the lumps that can't be evicted already
+        // take more than the budget.
+        void set_budget(const size_t bytes);
+
+        [[nodiscard]] size_t budget() const;
+        [[nodiscard]] size_t resident_bytes() const;
+
+        // Not thread safe, lumps can only be added while no other thread is using the cache
+        void add_lumps(const size_t n)
+        {
+            for (size_t i = 0; i < n; ++i)
+                slots_.emplace_back();
+        }
+
+    private:
+        struct slot_t
+        {
+            std::atomic<const std::byte*> data{nullptr};
+            std::atomic<purge_tag> tag{purge_tag::purgeable};
+            mutable std::atomic<std::uint32_t> last_used{0};
+            size_t size = 0;
+            std::unique_ptr<std::byte[]> storage;
+            bool is_lru_candidate = false;  // whether lru_ has an entry for the slot
+        };
+
+        // An entry of lru_: the slot's last_used when it was pushed and the slot
+        using lru_entry = std::pair<std::uint32_t, size_t>;
+
+        const std::byte* use_resident(slot_t& slot, const purge_tag tag);
+        void reserve(const size_t size);
+        void unreserve(const size_t size);
+        const std::byte* publish(const size_t num, const size_t size, const purge_tag tag,
+                                 std::unique_ptr<std::byte[]> storage);
+        void evict_until_fits(const size_t size);
+        void add_lru_candidate(const size_t num);
+
+        // slots never move once they've been added
+        std::deque<slot_t> slots_;
+
+        // misses on different lumps mostly go to different mutexes and don't wait for each other
+        std::array<std::mutex, 64> fill_mutexes_;
+
+        std::atomic<std::uint32_t> epoch_{0};
+
+        // guards everything below as well as changes to the tag and storage of the slots
+        mutable std::mutex mutex_;
+        size_t budget_ = unlimited;
+        size_t resident_bytes_ = 0;
+
+        // The purgeable lumps, least recently used first. Hits only touch the slots' last_used, so an entry
+        // can be out of date. Evicting brings it up to date before trusting it.
+        std::priority_queue<lru_entry, std::vector<lru_entry>, std::greater<>> lru_;
+        std::vector<std::unique_ptr<std::byte[]>> evicted_;
+        std::vector<std::unique_ptr<std::byte[]>> retired_;  // evicted before the last release_evicted
+    };
+}
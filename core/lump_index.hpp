@@ -0,0 +1,164 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace core
+{
+    // Lump names are at most 8 characters long so a whole name fits into a single 64 bit key. The name is
+    // upper-cased (lookups are case insensitive), its first character goes into the lowest byte and unused
+    // bytes are zero. Keys can be built at compile time, so looking up a lump by a literal name costs no
+    // more than looking it up by number.
+    class lump_key
+    {
+    public:
+        static constexpr size_t max_length = 8;
+
+        constexpr lump_key() = default;
+        constexpr lump_key(const char* name) : lump_key(std::string_view(name)) {}
+        constexpr lump_key(const std::string_view name) : value_(pack(name)) {}
+        lump_key(const std::string& name) : lump_key(std::string_view(name)) {}
+
+        // Names in wad structures are only zero terminated if they are shorter than 8 characters
+        constexpr explicit lump_key(const std::array<char, max_length>& name)
+            : value_(pack(std::string_view(name.data(), std::ranges::find(name, '\0') - name.begin())))
+        {
+        }
+
+        [[nodiscard]] static constexpr lump_key from_value(const std::uint64_t value)
+        {
+            lump_key result;
+            result.value_ = value;
+            return result;
+        }
+
+        constexpr auto operator<=>(const lump_key&) const = default;
+
+        [[nodiscard]] constexpr std::uint64_t value() const { return value_; }
+
+        [[nodiscard]] std::string to_string() const
+        {
+            std::string result;
+            for (auto v = value_; v != 0; v >>= 8U)
+                result.push_back(static_cast<char>(v & 0xffU));
+
+            return result;
+        }
+
+    private:
+        static constexpr std::uint64_t pack(const std::string_view name)
+        {
+            if (name.size() > max_length)
+                throw std::invalid_argument(fmt::format("'{}' is too long to be a lump name", name));
+
+            std::uint64_t result = 0;
+            for (auto i = 0U; const char c : name)
+            {
+                const auto upper = ((c >= 'a') && (c <= 'z')) ? static_cast<char>(c - 'a' + 'A') : c;
+                result |= static_cast<std::uint64_t>(static_cast<unsigned char>(upper)) << (8U * i++);
+            }
+
+            return result;
+        }
+
+        std::uint64_t value_ = 0;
+    };
+
+    namespace literals
+    {
+        // Always packed at compile time, a name that is too long doesn't compile
+        [[nodiscard]] consteval lump_key operator"" _lump(const char* name, const size_t length)
+        {
+            return lump_key(std::string_view(name, length));
+        }
+    }
+
+    // Maps lump keys to lump numbers. This is a flat open addressed (linear probing) hash table, so
+    // neither inserting nor looking up a name allocates.
+    class lump_index
+    {
+    public:
+        void insert_or_assign(const lump_key key, const size_t lump_num)
+        {
+            if (2 * (size_ + 1) > slots_.size()) rehash(std::max(min_capacity, 2 * slots_.size()));
+
+            auto& slot = find_slot(key);
+            if (slot.lump_num == empty) ++size_;
+
+            slot = {.key = key.value(), .lump_num = lump_num};
+        }
+
+        [[nodiscard]] std::optional<size_t> find(const lump_key key) const
+        {
+            if (slots_.empty()) return std::nullopt;
+
+            const auto lump_num = find_slot(key).lump_num;
+            return (lump_num != empty) ? std::optional(lump_num) : std::nullopt;
+        }
+
+        [[nodiscard]] bool contains(const lump_key key) const { return find(key).has_value(); }
+
+        [[nodiscard]] size_t size() const { return size_; }
+
+        void reserve(const size_t n)
+        {
+            auto capacity = std::max(min_capacity, slots_.size());
+            while (capacity < 2 * n)
+                capacity *= 2;
+
+            if (capacity > slots_.size()) rehash(capacity);
+        }
+
+    private:
+        static constexpr size_t empty = ~size_t{0};
+        static constexpr size_t min_capacity = 64;
+
+        struct slot_t
+        {
+            std::uint64_t key = 0;
+            size_t lump_num = empty;
+        };
+
+        std::vector<slot_t> slots_;
+        size_t size_ = 0;
+
+        [[nodiscard]] size_t home_index(const lump_key key) const
+        {
+            // Fibonacci hashing spreads the mostly-ASCII bytes of the key over the whole table
+            constexpr auto golden_ratio = std::uint64_t{0x9e3779b97f4a7c15};
+            return static_cast<size_t>((key.value() * golden_ratio) >> 32U) & (slots_.size() - 1);
+        }
+
+        [[nodiscard]] const slot_t& find_slot(const lump_key key) const
+        {
+            auto i = home_index(key);
+            while ((slots_[i].lump_num != empty) && (slots_[i].key != key.value()))
+                i = (i + 1) & (slots_.size() - 1);
+
+            return slots_[i];
+        }
+
+        [[nodiscard]] slot_t& find_slot(const lump_key key)
+        {
+            return const_cast<slot_t&>(std::as_const(*this).find_slot(key));
+        }
+
+        void rehash(const size_t capacity)
+        {
+            auto old_slots = std::exchange(slots_, std::vector<slot_t>(capacity));
+            for (const auto& slot : old_slots)
+            {
+                if (slot.lump_num != empty) find_slot(lump_key::from_value(slot.key)) = slot;
+            }
+        }
+    };
+}
@@ -0,0 +1,47 @@
+#include <core/mapped_file.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utility>
+
+namespace core
+{
+    mapped_file::~mapped_file()
+    {
+        if (!bytes_.empty()) munmap(const_cast<std::byte*>(bytes_.data()), bytes_.size());
+    }
+
+    mapped_file::mapped_file(mapped_file&& other) noexcept : bytes_(std::exchange(other.bytes_, {})) {}
+
+    mapped_file& mapped_file::operator=(mapped_file&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (!bytes_.empty()) munmap(const_cast<std::byte*>(bytes_.data()), bytes_.size());
+            bytes_ = std::exchange(other.bytes_, {});
+        }
+
+        return *this;
+    }
+
+    std::optional<mapped_file> map_file(const std::filesystem::path& path)
+    {
+        const auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return std::nullopt;
+
+        struct stat info{};
+        const auto is_mappable = (fstat(fd, &info) == 0) && S_ISREG(info.st_mode) && (info.st_size > 0);
+        auto* const address =
+            is_mappable ? mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+
+        // the mapping keeps its own reference to the file
+        close(fd);
+
+        if (address == MAP_FAILED) return std::nullopt;
+
+        return mapped_file(std::span(static_cast<const std::byte*>(address), static_cast<size_t>(info.st_size)));
+    }
+}
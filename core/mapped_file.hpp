@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <span>
+
+namespace core
+{
+    // A read only mapping of an entire file. The pages are shared with the OS page cache and
+    // only faulted in when they are first touched, so nothing gets copied onto the heap.
+    class mapped_file
+    {
+    public:
+        ~mapped_file();
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file(mapped_file&& other) noexcept;
+        mapped_file& operator=(const mapped_file&) = delete;
+        mapped_file& operator=(mapped_file&& other) noexcept;
+
+        [[nodiscard]] std::span<const std::byte> bytes() const { return bytes_; }
+
+        friend std::optional<mapped_file> map_file(const std::filesystem::path& path);
+
+    private:
+        explicit mapped_file(const std::span<const std::byte> bytes) : bytes_(bytes) {}
+
+        std::span<const std::byte> bytes_;
+    };
+
+    // Returns std::nullopt if the file can't be mapped (e.g. it is empty or not a regular file)
+    std::optional<mapped_file> map_file(const std::filesystem::path& path);
+}
@@ -0,0 +1,127 @@
+#include <core/task_graph.hpp>
+
+#include <core/thread_pool.hpp>
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+namespace core
+{
+    task_graph::task_id task_graph::add(std::string name, std::function<void()> work,
+                                        const std::initializer_list<task_id> dependencies)
+    {
+        const auto id = tasks_.size();
+        for (const auto dependency : dependencies)
+        {
+            if (dependency >= id)
+            {
+                throw std::logic_error(
+                    fmt::format("Task {} depends on task {} which hasn't been added before it", name, dependency));
+            }
+
+            tasks_[dependency].dependents.push_back(id);
+        }
+
+        tasks_.push_back({.name = std::move(name),
+                          .work = std::move(work),
+                          .dependents = {},
+                          .num_dependencies = dependencies.size(),
+                          .time = {}});
+        return id;
+    }
+
+    void task_graph::run(thread_pool& pool)
+    {
+        if (tasks_.empty()) return;
+
+        struct state_t : std::enable_shared_from_this<state_t>
+        {
+            explicit state_t(const size_t n) : num_tasks(n), num_waiting_for(std::make_unique<std::atomic<size_t>[]>(n))
+            {
+            }
+
+            // once a task has counted itself as done the graph may be gone, so whatever it needs after that
+            // lives in here
+            const size_t num_tasks;
+            std::function<void(task_id)> submit;
+            std::unique_ptr<std::atomic<size_t>[]> num_waiting_for;
+            std::atomic<size_t> num_done{0};
+            std::atomic<bool> has_failed{false};
+            std::mutex mutex;
+            std::condition_variable done;
+            std::exception_ptr error;
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        };
+
+        const auto n = tasks_.size();
+        const auto state = std::make_shared<state_t>(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            state->num_waiting_for[i] = tasks_[i].num_dependencies;
+            tasks_[i].time = {.name = tasks_[i].name};
+        }
+
+        // a task submits the tasks it has been the last dependency of before counting itself as done, so
+        // everything has been submitted by the time the last task is done. Only the jobs own the state, the
+        // state just refers to itself.
+        state->submit = [this, &pool, &shared = *state](const task_id id) {
+            pool.submit([this, state = shared.shared_from_this(), id] {
+                auto& task = tasks_[id];
+                if (!state->has_failed)
+                {
+                    const auto start = std::chrono::steady_clock::now();
+                    try
+                    {
+                        task.work();
+                    }
+                    catch (...)
+                    {
+                        const auto lock = std::lock_guard(state->mutex);
+                        if (!state->error) state->error = std::current_exception();
+                        state->has_failed = true;
+                    }
+
+                    const auto end = std::chrono::steady_clock::now();
+                    task.time.start = start - state->start;
+                    task.time.duration = end - start;
+                }
+
+                for (const auto dependent : task.dependents)
+                {
+                    if (state->num_waiting_for[dependent].fetch_sub(1) == 1) state->submit(dependent);
+                }
+
+                if (state->num_done.fetch_add(1) + 1 == state->num_tasks)
+                {
+                    const auto lock = std::lock_guard(state->mutex);
+                    state->done.notify_all();
+                }
+            });
+        };
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (tasks_[i].num_dependencies == 0) state->submit(i);
+        }
+
+        auto lock = std::unique_lock(state->mutex);
+        state->done.wait(lock, [&] { return state->num_done == n; });
+        if (state->error) std::rethrow_exception(state->error);
+    }
+
+    std::vector<task_graph::timing> task_graph::timings() const
+    {
+        auto result = std::vector<timing>();
+        result.reserve(tasks_.size());
+        for (const auto& task : tasks_)
+            result.push_back(task.time);
+
+        return result;
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+namespace core
+{
+    class thread_pool;
+
+    // Tasks with dependencies between them. Running the graph hands every task to the thread pool as soon
+    // as all the tasks it depends on have finished, so independent tasks run concurrently.
+    class task_graph
+    {
+    public:
+        using task_id = size_t;
+
+        struct timing
+        {
+            std::string name;
+            std::chrono::duration<double, std::milli> start{};  // since the graph started running
+            std::chrono::duration<double, std::milli> duration{};
+        };
+
+        // A task can only depend on tasks that were added before it, which keeps the graph free of cycles
+        task_id add(std::string name, std::function<void()> work, std::initializer_list<task_id> dependencies = {});
+
+        // Returns once all tasks have finished. After a task throws, the tasks that haven't started yet are
+        // skipped and the exception is rethrown here.
+        void run(thread_pool& pool);
+
+        // Of the last run, in the order the tasks were added
+        [[nodiscard]] std::vector<timing> timings() const;
+
+    private:
+        struct task_t
+        {
+            std::string name;
+            std::function<void()> work;
+            std::vector<task_id> dependents;
+            size_t num_dependencies = 0;
+            timing time;
+        };
+
+        std::vector<task_t> tasks_;
+    };
+}
@@ -0,0 +1,59 @@
+#include <core/thread_pool.hpp>
+
+namespace core
+{
+    thread_pool::thread_pool(const size_t num_threads)
+    {
+        workers_.reserve(num_threads);
+        for (size_t i = 0; i < num_threads; ++i)
+            workers_.emplace_back([this] { run_worker(); });
+    }
+
+    thread_pool::~thread_pool()
+    {
+        {
+            const auto lock = std::lock_guard(mutex_);
+            is_stopping_ = true;
+        }
+
+        has_jobs_.notify_all();
+        for (auto& worker : workers_)
+            worker.join();
+    }
+
+    void thread_pool::push(std::function<void()> job)
+    {
+        if (workers_.empty())
+        {
+            job();
+            return;
+        }
+
+        {
+            const auto lock = std::lock_guard(mutex_);
+            jobs_.push_back(std::move(job));
+        }
+
+        has_jobs_.notify_one();
+    }
+
+    void thread_pool::run_worker()
+    {
+        while (true)
+        {
+            std::function<void()> job;
+            {
+                auto lock = std::unique_lock(mutex_);
+                has_jobs_.wait(lock, [this] { return is_stopping_ || !jobs_.empty(); });
+
+                // finish any queued work before stopping
+                if (jobs_.empty()) return;
+
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+
+            job();
+        }
+    }
+}
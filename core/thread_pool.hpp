@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace core
+{
+    class thread_pool
+    {
+    public:
+        // A pool without worker threads runs all of its work on the calling thread
+        explicit thread_pool(const size_t num_threads = std::thread::hardware_concurrency());
+        ~thread_pool();
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool(thread_pool&&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+        thread_pool& operator=(thread_pool&&) = delete;
+
+        [[nodiscard]] size_t size() const { return workers_.size(); }
+
+        template <typename Func>
+        std::future<std::invoke_result_t<Func>> submit(Func&& func)
+        {
+            auto task = std::make_shared<std::packaged_task<std::invoke_result_t<Func>()>>(std::forward<Func>(func));
+            auto result = task->get_future();
+            push([task] { (*task)(); });
+            return result;
+        }
+
+        // Calls func(i) for every i in [0, n) and returns once all calls have finished. The calling thread
+        // takes part in the work, so this can also be used from within a task running on the pool. The
+        // first exception thrown by func is rethrown here.
+        template <typename Func>
+        void parallel_for(const size_t n, Func&& func)
+        {
+            if (n == 0) return;
+
+            struct state_t
+            {
+                std::atomic<size_t> next{0};
+                std::atomic<size_t> num_done{0};
+                std::mutex mutex;
+                std::condition_variable done;
+                std::exception_ptr error;
+            };
+
+            // helpers that only get to run after all the work is done just find nothing left to do
+            const auto state = std::make_shared<state_t>();
+            const auto run = [state, n, &func] {
+                for (auto i = state->next++; i < n; i = state->next++)
+                {
+                    try
+                    {
+                        func(i);
+                    }
+                    catch (...)
+                    {
+                        const auto lock = std::lock_guard(state->mutex);
+                        if (!state->error) state->error = std::current_exception();
+                    }
+
+                    if (state->num_done.fetch_add(1) + 1 == n)
+                    {
+                        const auto lock = std::lock_guard(state->mutex);
+                        state->done.notify_all();
+                    }
+                }
+            };
+
+            for (size_t i = 0; i < std::min(size(), n - 1); ++i)
+                push(run);
+
+            run();
+
+            auto lock = std::unique_lock(state->mutex);
+            state->done.wait(lock, [&] { return state->num_done == n; });
+            if (state->error) std::rethrow_exception(state->error);
+        }
+
+    private:
+        void push(std::function<void()> job);
+        void run_worker();
+
+        std::mutex mutex_;
+        std::condition_variable has_jobs_;
+        std::deque<std::function<void()>> jobs_;
+        bool is_stopping_ = false;
+        std::vector<std::thread> workers_;
+    };
+}
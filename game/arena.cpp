@@ -5,6 +5,7 @@
 #include <core/vec.hpp>
 #include <core/wad_types.hpp>
 #include <game/level.hpp>
+#include <game/level_cache.hpp>
 #include <game/mobj.hpp>
 #include <grfx/system.hpp>
 #include <rndr/system.hpp>
@@ -42,23 +43,6 @@ namespace game
             player.mo.mom.y += move * sin(angle);
         }
 
-        const sub_sector_t& sub_sector_containing_point(const level_t& level, const core::pos p)
-        {
-            // single sub-sector is a special case
-            if (level.nodes.empty()) return level.sub_sectors.front();
-
-            auto node_num = level.nodes.size() - 1;
-
-            while ((node_num & core::node_flags::sub_sector) == 0)
-            {
-                const auto& node = level.nodes[node_num];
-                const auto side = core::point_on_side(p, node);
-                node_num = node.children[static_cast<int>(side)].index;
-            }
-
-            return level.sub_sectors[node_num & ~core::node_flags::sub_sector];
-        }
-
         void spawn_player(const core::map_thing_t& thing, arena::impl& arena_data)
         {
             const auto index = thing.type - 1;
@@ -77,7 +61,8 @@ namespace game
         void load_things(core::game_data& data, const size_t lump, arena::impl& arena_data)
         {
             const auto num_things = lump_size(data, lump) / sizeof(core::map_thing_t);
-            const auto things = std::span(cache_lump_num<core::map_thing_t>(data, lump), num_things);
+            const auto* first = cache_lump_num<core::map_thing_t>(data, lump, core::purge_tag::purgeable);
+            const auto things = std::span(first, num_things);
 
             for (const auto& thing : things)
                 spawn_map_thing(thing, arena_data);
@@ -85,22 +70,38 @@ namespace game
     }
 
     arena::arena(const core::iwad_description& iwad, const start_parameters& parameters, core::game_data& data,
-                 const rndr::system& renderer)
+                 const rndr::system& renderer, const level_cache& levels)
         : impl_(std::make_unique<impl>(renderer))
     {
         const auto lump_name = (iwad.mode == core::game_mode::commercial)
                                    ? fmt::format("map{:02}", parameters.map)
                                    : fmt::format("E{}M{}", parameters.episode, parameters.map);
 
-        impl_->level = load_level(data, renderer, lump_name, fmt::format("SKY{}", parameters.episode));
-        load_things(data, data.lump_table[lump_name] + static_cast<size_t>(core::map_lump::things), *impl_);
+        // the lumps of the previous level can go once the cache needs the room
+        data.cache.purge_level();
+        impl_->level = levels.load(data, renderer, lump_name, sky_texture_name(lump_name));
+        // the timedemo and level_benchmark report what precaching keeps in memory
+        static_cast<void>(renderer.precache_level(impl_->level, data));
+
+        const auto label = core::lump_num(data, lump_name, core::lump_namespace::maps);
+        load_things(data, label + static_cast<size_t>(core::map_lump::things), *impl_);
     }
 
     arena::~arena() = default;
 
-    void arena::draw(grfx::system&, core::game_data& data) const
+    rndr::framebuffer_view screen_view(grfx::system& gfx)
+    {
+        // the view is centered on screens that are wider than the original one
+        const auto screen = gfx.screen_size();
+        return {.pixels = gfx.video_buffer().subspan(screen.delta_width),
+                .width = grfx::original_screen_width,
+                .height = grfx::original_screen_height,
+                .pitch = screen.width};
+    }
+
+    void arena::draw(grfx::system& gfx, core::game_data& data) const
     {
-        impl_->renderer.draw(impl_->level, impl_->players[0].mo, data);
+        impl_->renderer.draw(impl_->level, impl_->players[0].mo, data, screen_view(gfx));
     }
 
     void arena::tick()
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <core/event.hpp>
+#include <rndr/framebuffer.hpp>
 
 #include <memory>
 
@@ -22,6 +23,8 @@ namespace rndr
 
 namespace game
 {
+    class level_cache;
+
     struct start_parameters
     {
         int skill = 0;
@@ -33,7 +36,7 @@ namespace game
     {
     public:
         explicit arena(const core::iwad_description& iwad, const start_parameters& parameters, core::game_data& data,
-                       const rndr::system& renderer);
+                       const rndr::system& renderer, const level_cache& levels);
         ~arena();
 
         void draw(grfx::system& gfx, core::game_data& data) const;
@@ -45,4 +48,7 @@ namespace game
     private:
         std::unique_ptr<impl> impl_;
     };
+
+    // The part of the screen the 3D view is drawn to
+    rndr::framebuffer_view screen_view(grfx::system& gfx);
 }
\ No newline at end of file
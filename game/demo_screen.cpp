@@ -7,7 +7,7 @@ namespace game
 {
     void demo_screen::draw(grfx::system& gfx, core::game_data& data) const
     {
-        gfx.draw_patch(0, 0, *core::cache_lump<grfx::patch_t>(data, title_));
+        gfx.draw_patch(0, 0, *core::cache_lump<grfx::patch_t>(data, title_, core::purge_tag::purgeable));
     }
 
 }
\ No newline at end of file
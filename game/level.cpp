@@ -1,19 +1,73 @@
 #include <game/level.hpp>
 
 #include <core/game_data.hpp>
+#include <core/math.hpp>
+#include <core/task_graph.hpp>
+#include <core/thread_pool.hpp>
 #include <core/wad_types.hpp>
 #include <rndr/system.hpp>
-#include <stdx/to.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace game
 {
     namespace
     {
-        template <typename MapType, typename Conversion>
-        auto load(core::game_data& data, const size_t lump, const Conversion to_game_type)
+        using namespace ::core::literals;
+
+        // The level memory is released without running any destructors
+        template <typename T>
+        std::span<T> allocate(std::pmr::memory_resource& memory, const size_t n)
+        {
+            static_assert(std::is_trivially_destructible_v<T>);
+            return {static_cast<T*>(memory.allocate(n * sizeof(T), alignof(T))), n};
+        }
+
+        template <typename T, typename MapType>
+        size_t level_memory_size(const core::game_data& data, const size_t lump, const size_t n_per_map_item = 1)
+        {
+            return (static_cast<size_t>(core::lump_size(data, lump)) / sizeof(MapType)) * n_per_map_item * sizeof(T) +
+                   alignof(T);
+        }
+
+        // The map items of a lump, converted to the game type, fill an array of the same size
+        template <typename T, typename MapType>
+        std::span<T> allocate_for(const core::game_data& data, std::pmr::memory_resource& memory, const size_t lump)
         {
-            const auto map_vertices = core::cache_lump_num_as_span<MapType>(data, lump);
-            return map_vertices | std::views::transform(to_game_type) | stdx::to<std::vector>();
+            return allocate<T>(memory, static_cast<size_t>(core::lump_size(data, lump)) / sizeof(MapType));
+        }
+
+        // How many map items a task on the thread pool works on
+        constexpr auto chunk_size = size_t{4096};
+
+        // Calls func(begin, end) for consecutive ranges of [0, n) on the thread pool
+        template <typename Func>
+        void for_each_chunk(core::thread_pool& pool, const size_t n, Func&& func)
+        {
+            pool.parallel_for((n + chunk_size - 1) / chunk_size, [&](const size_t chunk) {
+                func(chunk * chunk_size, std::min(n, (chunk + 1) * chunk_size));
+            });
+        }
+
+        // Every item is converted on its own, so the items can be spread over the thread pool
+        template <typename MapType, typename T, typename Conversion>
+        void load(core::game_data& data, core::thread_pool& pool, const size_t lump, const std::span<T> result,
+                  const Conversion to_game_type)
+        {
+            const auto map_items = core::cache_lump_num_as_span<MapType>(data, lump, core::purge_tag::purgeable);
+            for_each_chunk(pool, result.size(), [&](const size_t begin, const size_t end) {
+                for (auto i = begin; i < end; ++i)
+                    std::construct_at(&result[i], to_game_type(map_items[i]));
+            });
         }
 
         template <typename T>
@@ -30,57 +84,53 @@ namespace game
             return result;
         }
 
-        blockmap_t load_blockmap(core::game_data& data, const size_t lump)
+        void load_vertices(core::game_data& data, core::thread_pool& pool, const size_t lump,
+                           const vertices_t vertices)
         {
-            struct blockmap_info
-            {
-                short x, y, width, height;
-            };
-
-            auto stream = core::lump_byte_stream(data, lump);
-            const auto info = stream.read<blockmap_info>();
-            const auto map = stream.read_span<short>(static_cast<size_t>(info.width * info.height));
-            return {.width = info.width,
-                    .height = info.height,
-                    .map = map,
-                    .x = core::units(info.x),
-                    .y = core::units(info.y)};
-
-            // todo clear out mobj chains
-            // const auto count = sizeof(*blocklinks) * bmapwidth*bmapheight;
-            // blocklinks = Z_Malloc (count,PU_LEVEL, 0);
-            // memset (blocklinks, 0, count);
+            load<core::map_vertex>(data, pool, lump, vertices, [](const core::map_vertex& v) {
+                return core::pos{.x = core::units(v.x), .y = core::units(v.y)};
+            });
         }
 
-        vertices_t load_vertices(core::game_data& data, const size_t lump)
+        // Sectors keep their flats as int lump numbers
+        int flat_num(const core::game_data& data, const core::lump_key name)
         {
-            return load<core::map_vertex>(data, lump, [](const core::map_vertex& v) {
-                return core::pos{.x = core::units(v.x), .y = core::units(v.y)};
-            });
+            const auto num = core::lump_num(data, name, core::lump_namespace::flats);
+            if (num > static_cast<size_t>(std::numeric_limits<int>::max()))
+            {
+                throw std::runtime_error(
+                    fmt::format("Flat {} is lump {}, sectors can't refer to it", name.to_string(), num));
+            }
+
+            return static_cast<int>(num);
         }
 
-        sectors_t load_sectors(core::game_data& data, const size_t lump)
+        void load_sectors(core::game_data& data, core::thread_pool& pool, const size_t lump, const sectors_t sectors)
         {
-            return load<core::map_sector>(data, lump, [&](const core::map_sector& s) {
+            load<core::map_sector>(data, pool, lump, sectors, [&](const core::map_sector& s) {
                 return sector_t{.floor_height = core::units(s.floor_height),
                                 .ceiling_height = core::units(s.ceiling_height),
-                                .floor_pic = static_cast<short>(data.lump_table[core::array_to_string(s.floor_pic)]),
-                                .ceiling_pic =
-                                    static_cast<short>(data.lump_table[core::array_to_string(s.ceiling_pic)]),
+                                .floor_pic = flat_num(data, core::lump_key(s.floor_pic)),
+                                .ceiling_pic = flat_num(data, core::lump_key(s.ceiling_pic)),
                                 .light_level = s.light_level,
                                 .special = s.special,
-                                .tag = s.tag};
+                                .tag = s.tag,
+                                .block_box = {},
+                                .sound_origin = {},
+                                .lines = {}};
             });
         }
 
-        sides_t load_sides(core::game_data& data, const rndr::system& renderer, sectors_t& sectors, const size_t lump)
+        // Only takes the addresses of the sectors, so the sectors don't have to be loaded yet
+        void load_sides(core::game_data& data, core::thread_pool& pool, const rndr::system& renderer,
+                        const sectors_t sectors, const size_t lump, const sides_t sides)
         {
-            return load<core::map_side_def>(data, lump, [&](const core::map_side_def& s) {
+            load<core::map_side_def>(data, pool, lump, sides, [&](const core::map_side_def& s) {
                 return side_t{.texture_offset = core::units(s.texture_offset),
                               .row_offset = core::units(s.row_offset),
-                              .top_texture = renderer.texture_num(core::array_to_string(s.top_texture)),
-                              .bottom_texture = renderer.texture_num(core::array_to_string(s.bottom_texture)),
-                              .mid_texture = renderer.texture_num(core::array_to_string(s.mid_texture)),
+                              .top_texture = renderer.texture_num(core::lump_key(s.top_texture)),
+                              .bottom_texture = renderer.texture_num(core::lump_key(s.bottom_texture)),
+                              .mid_texture = renderer.texture_num(core::lump_key(s.mid_texture)),
                               .sector = &sectors[s.sector]};
             });
         }
@@ -93,9 +143,10 @@ namespace game
                                       : (((dy / dx) > real{0}) ? slope_type_t::positive : slope_type_t::negative));
         }
 
-        lines_t load_lines(core::game_data& data, const vertices_t& vertices, const sides_t& sides, const size_t lump)
+        void load_lines(core::game_data& data, core::thread_pool& pool, const vertices_t vertices,
+                        const sides_t sides, const size_t lump, const lines_t lines)
         {
-            return load<core::map_line_def>(data, lump, [&](const core::map_line_def& m) {
+            load<core::map_line_def>(data, pool, lump, lines, [&](const core::map_line_def& m) {
                 const auto* v1 = &vertices[m.v1];
                 const auto* v2 = &vertices[m.v2];
                 const auto dx = v2->x - v1->x;
@@ -115,14 +166,15 @@ namespace game
             });
         }
 
-        sub_sectors_t load_sub_sectors(core::game_data& data, const size_t lump)
+        void load_sub_sectors(core::game_data& data, core::thread_pool& pool, const size_t lump,
+                              const sub_sectors_t sub_sectors)
         {
-            return load<core::map_sub_sector>(data, lump, [&](const core::map_sub_sector& s) {
+            load<core::map_sub_sector>(data, pool, lump, sub_sectors, [&](const core::map_sub_sector& s) {
                 return sub_sector_t{.num_lines = s.num_segs, .first_line = s.first_seg};
             });
         }
 
-        nodes_t load_nodes(core::game_data& data, const size_t lump)
+        void load_nodes(core::game_data& data, core::thread_pool& pool, const size_t lump, const nodes_t nodes)
         {
             const auto get_child = [](const unsigned short index, const std::array<short, 4>& bbox) {
                 return node_child_t{.index = index,
@@ -132,7 +184,7 @@ namespace game
                                              .right = core::units(bbox[3])}};
             };
 
-            return load<core::map_node_t>(data, lump, [&](const core::map_node_t& n) {
+            load<core::map_node_t>(data, pool, lump, nodes, [&](const core::map_node_t& n) {
                 return node_t{
                     .x = core::units(n.x),
                     .y = core::units(n.y),
@@ -142,10 +194,10 @@ namespace game
             });
         }
 
-        segs_t load_segs(core::game_data& data, const vertices_t& vertices, const lines_t& lines, const sides_t& sides,
-                         const size_t lump)
+        void load_segs(core::game_data& data, core::thread_pool& pool, const vertices_t vertices,
+                       const lines_t lines, const sides_t sides, const size_t lump, const segs_t segs)
         {
-            return load<core::map_seg_t>(data, lump, [&](const core::map_seg_t& s) {
+            load<core::map_seg_t>(data, pool, lump, segs, [&](const core::map_seg_t& s) {
                 const auto* line_def = &lines[s.line_def];
                 const auto* v1 = &vertices[s.v1];
                 const auto* v2 = &vertices[s.v2];
@@ -163,81 +215,234 @@ namespace game
             });
         }
 
-        void group_lines(level_t& level)
+        void group_lines(level_t& level, core::thread_pool& pool, std::pmr::memory_resource& memory)
         {
             // look up sector number for each subsector
-            for (auto& s : level.sub_sectors)
-                s.sector = level.segs[s.first_line].side_def->sector;
+            for_each_chunk(pool, level.sub_sectors.size(), [&](const size_t begin, const size_t end) {
+                for (auto& s : level.sub_sectors.subspan(begin, end - begin))
+                    s.sector = level.segs[s.first_line].side_def->sector;
+            });
+
+            const auto for_each_line_sector = [&level](const size_t begin, const size_t end, const auto func) {
+                for (auto& l : level.lines.subspan(begin, end - begin))
+                {
+                    if (l.front_sector != nullptr) func(l, *l.front_sector);
 
-            // count number of lines in each sector
-            for (auto& l : level.lines)
+                    if (l.back_sector != nullptr && l.front_sector != l.back_sector) func(l, *l.back_sector);
+                }
+            };
+
+            const auto sector_index = [&level](const sector_t& sector) {
+                return static_cast<size_t>(&sector - level.sectors.data());
+            };
+
+            // Count the lines of each sector separately for every chunk of lines, then give every chunk its
+            // own part of each sector's line table. This keeps the lines of a sector in line order, just like
+            // filling the tables one line after the other would.
+            const auto num_sectors = level.sectors.size();
+            const auto num_chunks = (level.lines.size() + chunk_size - 1) / chunk_size;
+            // func gets each line and the index of the counter its chunk has for the line's sector
+            const auto for_each_lines_chunk = [&](const auto func) {
+                pool.parallel_for(num_chunks, [&](const size_t chunk) {
+                    const auto begin = chunk * chunk_size;
+                    const auto end = std::min(level.lines.size(), begin + chunk_size);
+                    for_each_line_sector(begin, end, [&](line_t& line, sector_t& sector) {
+                        func(line, chunk * num_sectors + sector_index(sector));
+                    });
+                });
+            };
+
+            auto counts = std::vector<size_t>(num_chunks * num_sectors);
+            for_each_lines_chunk([&](const line_t&, const size_t counter) { ++counts[counter]; });
+
+            // build line tables, all sectors share one buffer
+            level.sector_lines = allocate<line_t*>(memory, std::reduce(counts.begin(), counts.end()));
+            for (auto offset = size_t{0}; auto& sector : level.sectors)
             {
-                if (l.front_sector != nullptr) l.front_sector->lines.push_back(&l);
+                const auto first = offset;
+                for (size_t chunk = 0; chunk < num_chunks; ++chunk)
+                {
+                    auto& count = counts[chunk * num_sectors + sector_index(sector)];
+                    offset += std::exchange(count, offset);
+                }
 
-                if (l.back_sector != nullptr && l.front_sector != l.back_sector) l.back_sector->lines.push_back(&l);
+                sector.lines = level.sector_lines.subspan(first, offset - first);
             }
 
-            /*todo
+            for_each_lines_chunk(
+                [&](line_t& line, const size_t counter) { level.sector_lines[counts[counter]++] = &line; });
+        }
 
-            // Generate bounding boxes for sectors
+        // Generates the bounding boxes of the sectors from their lines
+        void set_sector_bounds(level_t& level, core::thread_pool& pool)
+        {
+            // things can stick this far out of the blocks they are linked into
+            constexpr auto max_radius = core::units(32);
+            constexpr auto block_size = core::units(128);
 
-            sector = sectors;
-            for (i = 0; i < numsectors; i++, sector++)
-            {
-                M_ClearBox(bbox);
+            const auto& blockmap = level.blockmap;
+            const auto block = [&](const core::units distance, const int size) {
+                return std::clamp(static_cast<int>(std::floor(distance / block_size)), 0, std::max(size - 1, 0));
+            };
 
-                for (j = 0; j < sector->linecount; j++)
+            for_each_chunk(pool, level.sectors.size(), [&](const size_t begin, const size_t end) {
+                for (auto& sector : level.sectors.subspan(begin, end - begin))
                 {
-                    li = sector->lines[j];
-
-                    M_AddToBox(bbox, li->v1->x, li->v1->y);
-                    M_AddToBox(bbox, li->v2->x, li->v2->y);
+                    if (sector.lines.empty()) continue;
+
+                    auto bbox = get_bounding_box(*sector.lines[0]->v1, *sector.lines[0]->v1);
+                    for (const auto* line : sector.lines)
+                    {
+                        bbox.top = std::max(bbox.top, line->bbox.top);
+                        bbox.bottom = std::min(bbox.bottom, line->bbox.bottom);
+                        bbox.left = std::min(bbox.left, line->bbox.left);
+                        bbox.right = std::max(bbox.right, line->bbox.right);
+                    }
+
+                    // set the sound origin to the middle of the bounding box
+                    sector.sound_origin = {.x = (bbox.left + bbox.right) / real{2},
+                                           .y = (bbox.bottom + bbox.top) / real{2}};
+
+                    // adjust bounding box to map blocks
+                    sector.block_box = {.top = block(bbox.top - blockmap.y + max_radius, blockmap.height),
+                                        .bottom = block(bbox.bottom - blockmap.y - max_radius, blockmap.height),
+                                        .left = block(bbox.left - blockmap.x - max_radius, blockmap.width),
+                                        .right = block(bbox.right - blockmap.x + max_radius, blockmap.width)};
                 }
+            });
+        }
+    }
 
-                // set the degenmobj_t to the middle of the bounding box
-                sector->soundorg.x = (bbox[BOXRIGHT] + bbox[BOXLEFT]) / 2;
-                sector->soundorg.y = (bbox[BOXTOP] + bbox[BOXBOTTOM]) / 2;
+    blockmap_t load_blockmap(core::game_data& data, const size_t lump)
+    {
+        struct blockmap_info
+        {
+            short x, y, width, height;
+        };
+
+        // the blockmap is used in place for as long as the level exists
+        auto stream = core::lump_byte_stream(data, lump, core::purge_tag::level);
+        const auto info = stream.read<blockmap_info>();
+        const auto map = stream.read_span<short>(static_cast<size_t>(info.width * info.height));
+        return {.width = info.width,
+                .height = info.height,
+                .map = map,
+                .x = core::units(info.x),
+                .y = core::units(info.y)};
+
+        // todo clear out mobj chains
+        // const auto count = sizeof(*blocklinks) * bmapwidth*bmapheight;
+        // blocklinks = Z_Malloc (count,PU_LEVEL, 0);
+        // memset (blocklinks, 0, count);
+    }
 
-                // adjust bounding box to map blocks
-                block                    = (bbox[BOXTOP] - bmaporgy + MAXRADIUS) >> MAPBLOCKSHIFT;
-                block                    = block >= bmapheight ? bmapheight - 1 : block;
-                sector->blockbox[BOXTOP] = block;
+    const sub_sector_t& sub_sector_containing_point(const level_t& level, const core::pos p)
+    {
+        // single sub-sector is a special case
+        if (level.nodes.empty()) return level.sub_sectors.front();
 
-                block                       = (bbox[BOXBOTTOM] - bmaporgy - MAXRADIUS) >> MAPBLOCKSHIFT;
-                block                       = block < 0 ? 0 : block;
-                sector->blockbox[BOXBOTTOM] = block;
+        auto node_num = level.nodes.size() - 1;
 
-                block                      = (bbox[BOXRIGHT] - bmaporgx + MAXRADIUS) >> MAPBLOCKSHIFT;
-                block                      = block >= bmapwidth ? bmapwidth - 1 : block;
-                sector->blockbox[BOXRIGHT] = block;
+        while ((node_num & core::node_flags::sub_sector) == 0)
+        {
+            const auto& node = level.nodes[node_num];
+            const auto side = core::point_on_side(p, node);
+            node_num = node.children[static_cast<int>(side)].index;
+        }
 
-                block                     = (bbox[BOXLEFT] - bmaporgx - MAXRADIUS) >> MAPBLOCKSHIFT;
-                block                     = block < 0 ? 0 : block;
-                sector->blockbox[BOXLEFT] = block;
-            }
-             */
+        return level.sub_sectors[node_num & ~core::node_flags::sub_sector];
+    }
+
+    std::string sky_texture_name(const std::string& lump_name)
+    {
+        const auto name = core::lump_key(lump_name).to_string();
+        const auto is_digit = [](const char c) { return (c >= '0') && (c <= '9'); };
+        if ((name.size() == 5) && name.starts_with("MAP") && is_digit(name[3]) && is_digit(name[4]))
+        {
+            const auto num = (name[3] - '0') * 10 + (name[4] - '0');
+            return (num < 12) ? "SKY1" : ((num < 21) ? "SKY2" : "SKY3");
         }
+
+        if ((name.size() == 4) && (name[0] == 'E') && is_digit(name[1]) && (name[2] == 'M') && is_digit(name[3]))
+            return fmt::format("SKY{}", name[1]);
+
+        return "SKY1";
     }
 
-    level_t load_level(core::game_data& data, const rndr::system& renderer, const std::string& lump_name,
-                       const std::string& sky_name)
+    level_t load_level(core::game_data& data, const rndr::system& renderer, core::thread_pool& pool,
+                       const std::string& lump_name, const std::string& sky_name, load_timings* timings)
     {
-        const auto lump_num = data.lump_table[lump_name];
+        const auto lump_num = core::lump_num(data, lump_name, core::lump_namespace::maps);
+
+        const auto map_lump = [lump_num](const core::map_lump lump) {
+            return lump_num + static_cast<size_t>(lump);
+        };
+
+        // every line is in the line table of at most two sectors
+        const auto memory_size =
+            level_memory_size<core::pos, core::map_vertex>(data, map_lump(core::map_lump::vertices)) +
+            level_memory_size<sector_t, core::map_sector>(data, map_lump(core::map_lump::sectors)) +
+            level_memory_size<side_t, core::map_side_def>(data, map_lump(core::map_lump::side_defs)) +
+            level_memory_size<line_t, core::map_line_def>(data, map_lump(core::map_lump::line_defs)) +
+            level_memory_size<line_t*, core::map_line_def>(data, map_lump(core::map_lump::line_defs), 2) +
+            level_memory_size<sub_sector_t, core::map_sub_sector>(data, map_lump(core::map_lump::sub_sectors)) +
+            level_memory_size<node_t, core::map_node_t>(data, map_lump(core::map_lump::nodes)) +
+            level_memory_size<seg_t, core::map_seg_t>(data, map_lump(core::map_lump::segs));
 
         level_t lvl;
-        lvl.sky_flat_num = data.lump_table.find("F_SKY1")->second;
+        // zeroed, so the gaps between the arrays don't end up in the level cache as garbage
+        lvl.memory = std::make_unique<std::byte[]>(memory_size);
+        lvl.memory_size = memory_size;
+        auto memory =
+            std::pmr::monotonic_buffer_resource(lvl.memory.get(), memory_size, std::pmr::null_memory_resource());
+
+        lvl.sky_flat_num = flat_num(data, "F_SKY1"_lump);
         lvl.sky_texture = renderer.texture_num(sky_name);
-        lvl.blockmap = load_blockmap(data, lump_num + static_cast<size_t>(core::map_lump::blockmap));
-        lvl.vertices = load_vertices(data, lump_num + static_cast<size_t>(core::map_lump::vertices));
-        lvl.sectors = load_sectors(data, lump_num + static_cast<size_t>(core::map_lump::sectors));
-        lvl.sides = load_sides(data, renderer, lvl.sectors, lump_num + static_cast<size_t>(core::map_lump::side_defs));
-        lvl.lines =
-            load_lines(data, lvl.vertices, lvl.sides, lump_num + static_cast<size_t>(core::map_lump::line_defs));
-        lvl.sub_sectors = load_sub_sectors(data, lump_num + static_cast<size_t>(core::map_lump::sub_sectors));
-        lvl.nodes = load_nodes(data, lump_num + static_cast<size_t>(core::map_lump::nodes));
-        lvl.segs =
-            load_segs(data, lvl.vertices, lvl.lines, lvl.sides, lump_num + static_cast<size_t>(core::map_lump::segs));
-        group_lines(lvl);
+
+        // The memory resource isn't thread safe, so all arrays whose size is known up front are allocated
+        // here. The stages only fill them in.
+        lvl.vertices = allocate_for<core::pos, core::map_vertex>(data, memory, map_lump(core::map_lump::vertices));
+        lvl.sectors = allocate_for<sector_t, core::map_sector>(data, memory, map_lump(core::map_lump::sectors));
+        lvl.sides = allocate_for<side_t, core::map_side_def>(data, memory, map_lump(core::map_lump::side_defs));
+        lvl.lines = allocate_for<line_t, core::map_line_def>(data, memory, map_lump(core::map_lump::line_defs));
+        lvl.sub_sectors =
+            allocate_for<sub_sector_t, core::map_sub_sector>(data, memory, map_lump(core::map_lump::sub_sectors));
+        lvl.nodes = allocate_for<node_t, core::map_node_t>(data, memory, map_lump(core::map_lump::nodes));
+        lvl.segs = allocate_for<seg_t, core::map_seg_t>(data, memory, map_lump(core::map_lump::segs));
+
+        auto stages = core::task_graph();
+        const auto blockmap = stages.add("blockmap", [&] {
+            lvl.blockmap = load_blockmap(data, map_lump(core::map_lump::blockmap));
+        });
+        const auto vertices = stages.add("vertices", [&] {
+            load_vertices(data, pool, map_lump(core::map_lump::vertices), lvl.vertices);
+        });
+        const auto sectors = stages.add("sectors", [&] {
+            load_sectors(data, pool, map_lump(core::map_lump::sectors), lvl.sectors);
+        });
+        const auto sides = stages.add("sides", [&] {
+            load_sides(data, pool, renderer, lvl.sectors, map_lump(core::map_lump::side_defs), lvl.sides);
+        });
+        const auto lines = stages.add(
+            "lines",
+            [&] { load_lines(data, pool, lvl.vertices, lvl.sides, map_lump(core::map_lump::line_defs), lvl.lines); },
+            {vertices, sides});
+        const auto sub_sectors = stages.add("sub_sectors", [&] {
+            load_sub_sectors(data, pool, map_lump(core::map_lump::sub_sectors), lvl.sub_sectors);
+        });
+        stages.add("nodes", [&] { load_nodes(data, pool, map_lump(core::map_lump::nodes), lvl.nodes); });
+        const auto segs = stages.add(
+            "segs",
+            [&] {
+                load_segs(data, pool, lvl.vertices, lvl.lines, lvl.sides, map_lump(core::map_lump::segs), lvl.segs);
+            },
+            {vertices, lines, sides});
+        const auto grouped_lines =
+            stages.add("group_lines", [&] { group_lines(lvl, pool, memory); }, {sectors, lines, sub_sectors, segs});
+        stages.add("sector_bounds", [&] { set_sector_bounds(lvl, pool); }, {blockmap, grouped_lines});
+
+        stages.run(pool);
+        if (timings != nullptr) *timings = stages.timings();
 
         return lvl;
     }
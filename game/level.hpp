@@ -1,9 +1,12 @@
 #pragma once
 
 #include <core/radians.hpp>
+#include <core/task_graph.hpp>
 #include <core/vec.hpp>
 
 #include <array>
+#include <cstddef>
+#include <memory>
 #include <span>
 #include <string>
 #include <vector>
@@ -11,6 +14,7 @@
 namespace core
 {
     struct game_data;
+    class thread_pool;
 }
 
 namespace rndr
@@ -31,7 +35,16 @@ namespace game
         core::units y;
     };
 
-    using vertices_t = std::vector<core::pos>;
+    using vertices_t = std::span<core::pos>;
+
+    // In blockmap cells
+    struct block_box_t
+    {
+        int top = 0;
+        int bottom = 0;
+        int left = 0;
+        int right = 0;
+    };
 
     struct sector_t
     {
@@ -50,12 +63,6 @@ namespace game
         // thing that made a sound (or null)
         mobj_t* sound_target;
 
-        // mapblock bounding box for height changes
-        int block_box[4];
-
-        // origin for any sounds played by the sector
-        degenmobj_t sound_org;
-
         // if == validcount, already checked
         int valid_count;
 
@@ -66,10 +73,16 @@ namespace game
         void* special_data;
          */
 
-        std::vector<line_t*> lines;
+        // mapblock bounding box for height changes
+        block_box_t block_box;
+
+        // origin for any sounds played by the sector
+        core::pos sound_origin;
+
+        std::span<line_t*> lines;
     };
 
-    using sectors_t = std::vector<sector_t>;
+    using sectors_t = std::span<sector_t>;
 
     struct side_t
     {
@@ -89,7 +102,7 @@ namespace game
         sector_t* sector = nullptr;
     };
 
-    using sides_t = std::vector<side_t>;
+    using sides_t = std::span<side_t>;
 
     struct bounding_box_t
     {
@@ -147,7 +160,7 @@ namespace game
         void* special_data = nullptr;
     };
 
-    using lines_t = std::vector<line_t>;
+    using lines_t = std::span<line_t>;
 
     struct sub_sector_t
     {
@@ -156,7 +169,7 @@ namespace game
         int first_line = 0;
     };
 
-    using sub_sectors_t = std::vector<sub_sector_t>;
+    using sub_sectors_t = std::span<sub_sector_t>;
 
     struct node_child_t
     {
@@ -175,7 +188,7 @@ namespace game
         std::array<node_child_t, 2> children;
     };
 
-    using nodes_t = std::vector<node_t>;
+    using nodes_t = std::span<node_t>;
 
     struct seg_t
     {
@@ -198,10 +211,17 @@ namespace game
         core::units length;
     };
 
-    using segs_t = std::vector<seg_t>;
+    using segs_t = std::span<seg_t>;
 
+    // All the geometry of a level lives in a single block of memory that is sized from the map lumps when
+    // the level is loaded and freed in one go with the level. The types stored in it are trivially
+    // destructible, so nothing has to be destroyed element by element. Pointers in the geometry only point
+    // into this block, which lets the level cache store and relocate it as a whole.
     struct level_t
     {
+        std::unique_ptr<std::byte[]> memory;
+        size_t memory_size = 0;
+
         int sky_flat_num = 0;
         int sky_texture = 0;
 
@@ -217,8 +237,21 @@ namespace game
         sub_sectors_t sub_sectors;
         nodes_t nodes;
         segs_t segs;
+        std::span<line_t*> sector_lines;  // the line tables of all sectors
     };
 
-    level_t load_level(core::game_data& data, const rndr::system& renderer, const std::string& lump_name,
-                       const std::string& sky_name);
+    blockmap_t load_blockmap(core::game_data& data, const size_t lump);
+
+    const sub_sector_t& sub_sector_containing_point(const level_t& level, const core::pos p);
+
+    // The sky the original game uses for a map: ExMy maps have the sky of their episode, MAPxx maps change
+    // skies after maps 11 and 20. Any other map gets the first sky.
+    std::string sky_texture_name(const std::string& lump_name);
+
+    // How long each stage of loading a level took
+    using load_timings = std::vector<core::task_graph::timing>;
+
+    // The stages of loading run on the thread pool as soon as the stages they depend on are done
+    level_t load_level(core::game_data& data, const rndr::system& renderer, core::thread_pool& pool,
+                       const std::string& lump_name, const std::string& sky_name, load_timings* timings = nullptr);
 }
\ No newline at end of file
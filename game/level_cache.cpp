@@ -0,0 +1,322 @@
+#include <game/level_cache.hpp>
+
+#include <core/game_data.hpp>
+#include <core/mapped_file.hpp>
+#include <rndr/system.hpp>
+
+#include <fmt/format.h>
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace game
+{
+    namespace
+    {
+        // Bump this whenever the layout of the level types or of the cache file changes
+        constexpr std::uint32_t format_version = 3;
+
+        constexpr auto file_magic = std::array{'D', 'P', 'P', 'L', 'E', 'V', 'E', 'L'};
+
+        struct array_ref
+        {
+            std::uint64_t offset = 0;  // from the start of the level memory
+            std::uint64_t size = 0;
+        };
+
+        // The level memory follows the header. Pointers in it are stored as the file offsets of what they
+        // point to, which keeps them distinct from null.
+        struct file_header
+        {
+            std::array<char, 8> magic{};
+            std::uint32_t version = 0;
+            std::int32_t sky_flat_num = 0;
+            std::int32_t sky_texture = 0;
+            std::uint32_t padding = 0;
+            std::uint64_t key = 0;
+            std::uint64_t memory_size = 0;
+            array_ref vertices;
+            array_ref sectors;
+            array_ref sides;
+            array_ref lines;
+            array_ref sub_sectors;
+            array_ref nodes;
+            array_ref segs;
+            array_ref sector_lines;
+        };
+
+        constexpr auto image_base = std::uintptr_t{sizeof(file_header)};
+
+        std::uint64_t hash_bytes(std::uint64_t hash, const std::span<const std::byte> bytes)
+        {
+            constexpr auto multiplier = std::uint64_t{0x9e3779b97f4a7c15};
+            const auto mix = [&](const std::uint64_t value) {
+                hash = (hash ^ value) * multiplier;
+                hash ^= hash >> 32U;
+            };
+
+            auto i = size_t{0};
+            for (; i + sizeof(std::uint64_t) <= bytes.size(); i += sizeof(std::uint64_t))
+            {
+                std::uint64_t word = 0;
+                memcpy(&word, &bytes[i], sizeof(word));
+                mix(word);
+            }
+
+            for (; i < bytes.size(); ++i)
+                mix(static_cast<std::uint64_t>(bytes[i]));
+
+            mix(bytes.size());
+            return hash;
+        }
+
+        template <typename T>
+        std::uint64_t hash_value(const std::uint64_t hash, const T& value)
+        {
+            return hash_bytes(hash, std::as_bytes(std::span(&value, 1)));
+        }
+
+        // Only looks at the metadata of the mounted wads, so checking a cached level costs a few stat calls
+        // instead of reading the map. A wad that is changed in place gets a new write time.
+        std::uint64_t level_key(const core::game_data& data, const std::string& sky_name)
+        {
+            auto key = hash_value(0, format_version);
+            for (const auto size : {sizeof(core::pos), sizeof(sector_t), sizeof(side_t), sizeof(line_t),
+                                    sizeof(sub_sector_t), sizeof(node_t), sizeof(seg_t)})
+            {
+                key = hash_value(key, size);
+            }
+
+            // flat and texture numbers depend on the whole lump directory, so the level is only valid for the
+            // same wads mounted in the same order
+            for (const auto& path : data.wad_paths)
+            {
+                const auto name = std::filesystem::absolute(path).string();
+                key = hash_bytes(key, std::as_bytes(std::span(name)));
+                key = hash_value(key, std::filesystem::file_size(path));
+                key = hash_value(key, std::filesystem::last_write_time(path).time_since_epoch().count());
+            }
+
+            return hash_bytes(key, std::as_bytes(std::span(sky_name)));
+        }
+
+        struct arrays_t
+        {
+            vertices_t vertices;
+            sectors_t sectors;
+            sides_t sides;
+            lines_t lines;
+            sub_sectors_t sub_sectors;
+            nodes_t nodes;
+            segs_t segs;
+            std::span<line_t*> sector_lines;
+        };
+
+        template <typename Func>
+        void for_each_array(arrays_t& arrays, file_header& header, Func&& func)
+        {
+            func(arrays.vertices, header.vertices);
+            func(arrays.sectors, header.sectors);
+            func(arrays.sides, header.sides);
+            func(arrays.lines, header.lines);
+            func(arrays.sub_sectors, header.sub_sectors);
+            func(arrays.nodes, header.nodes);
+            func(arrays.segs, header.segs);
+            func(arrays.sector_lines, header.sector_lines);
+        }
+
+        // Moves every pointer in the level memory that points into the block starting at from to the same
+        // place in the block starting at to. The arrays have to refer to the memory that is being changed.
+        void relocate(const arrays_t& arrays, const std::uintptr_t from, const std::uintptr_t to,
+                      const size_t memory_size)
+        {
+            const auto move = [&]<typename T>(T*& ptr) {
+                if (ptr == nullptr) return;
+
+                const auto offset = reinterpret_cast<std::uintptr_t>(ptr) - from;
+                if (offset >= memory_size) throw std::runtime_error("Level cache pointer out of range");
+
+                ptr = reinterpret_cast<T*>(to + offset);
+            };
+
+            for (auto& sector : arrays.sectors)
+            {
+                auto* lines = sector.lines.data();
+                move(lines);
+                sector.lines = std::span(lines, sector.lines.size());
+            }
+
+            for (auto& side : arrays.sides)
+                move(side.sector);
+
+            for (auto& line : arrays.lines)
+            {
+                move(line.v1);
+                move(line.v2);
+                move(line.front_sector);
+                move(line.back_sector);
+            }
+
+            for (auto& sub_sector : arrays.sub_sectors)
+                move(sub_sector.sector);
+
+            for (auto& seg : arrays.segs)
+            {
+                move(seg.v1);
+                move(seg.v2);
+                move(seg.side_def);
+                move(seg.line_def);
+                move(seg.front_sector);
+                move(seg.back_sector);
+            }
+
+            for (auto*& line : arrays.sector_lines)
+                move(line);
+        }
+
+        std::optional<level_t> read_level(core::game_data& data, const std::filesystem::path& path,
+                                          const std::uint64_t key, const size_t label)
+        {
+            const auto file = core::map_file(path);
+            if (!file) return std::nullopt;
+
+            const auto bytes = file->bytes();
+            auto header = file_header();
+            if (bytes.size() < sizeof(header)) return std::nullopt;
+
+            memcpy(&header, bytes.data(), sizeof(header));
+            if ((header.magic != file_magic) || (header.version != format_version) || (header.key != key) ||
+                (header.memory_size != bytes.size() - sizeof(header)))
+            {
+                return std::nullopt;
+            }
+
+            level_t lvl;
+            lvl.memory_size = header.memory_size;
+            lvl.memory = std::make_unique_for_overwrite<std::byte[]>(lvl.memory_size);
+            memcpy(lvl.memory.get(), bytes.data() + sizeof(header), lvl.memory_size);
+
+            auto arrays = arrays_t();
+            auto is_valid = true;
+            for_each_array(arrays, header, [&]<typename T>(std::span<T>& array, const array_ref& ref) {
+                const auto fits = (ref.offset <= lvl.memory_size) &&
+                                  (ref.size <= (lvl.memory_size - ref.offset) / sizeof(T)) &&
+                                  (ref.offset % alignof(T) == 0);
+                is_valid = is_valid && fits;
+                if (fits) array = std::span(reinterpret_cast<T*>(lvl.memory.get() + ref.offset), ref.size);
+            });
+
+            if (!is_valid) return std::nullopt;
+
+            try
+            {
+                relocate(arrays, image_base, reinterpret_cast<std::uintptr_t>(lvl.memory.get()), lvl.memory_size);
+            }
+            catch (const std::runtime_error&)
+            {
+                return std::nullopt;
+            }
+
+            lvl.sky_flat_num = header.sky_flat_num;
+            lvl.sky_texture = header.sky_texture;
+            lvl.blockmap = load_blockmap(data, label + static_cast<size_t>(core::map_lump::blockmap));
+            lvl.vertices = arrays.vertices;
+            lvl.sectors = arrays.sectors;
+            lvl.sides = arrays.sides;
+            lvl.lines = arrays.lines;
+            lvl.sub_sectors = arrays.sub_sectors;
+            lvl.nodes = arrays.nodes;
+            lvl.segs = arrays.segs;
+            lvl.sector_lines = arrays.sector_lines;
+            return lvl;
+        }
+
+        void write_level(const level_t& lvl, const std::filesystem::path& path, const std::uint64_t key)
+        {
+            auto image = std::vector<std::byte>(sizeof(file_header) + lvl.memory_size);
+            auto* const memory = image.data() + sizeof(file_header);
+            memcpy(memory, lvl.memory.get(), lvl.memory_size);
+
+            // the array references are filled in below
+            auto header = file_header();
+            header.magic = file_magic;
+            header.version = format_version;
+            header.sky_flat_num = lvl.sky_flat_num;
+            header.sky_texture = lvl.sky_texture;
+            header.key = key;
+            header.memory_size = lvl.memory_size;
+
+            // the arrays of the copy in the image
+            auto arrays = arrays_t{.vertices = lvl.vertices,
+                                   .sectors = lvl.sectors,
+                                   .sides = lvl.sides,
+                                   .lines = lvl.lines,
+                                   .sub_sectors = lvl.sub_sectors,
+                                   .nodes = lvl.nodes,
+                                   .segs = lvl.segs,
+                                   .sector_lines = lvl.sector_lines};
+            for_each_array(arrays, header, [&]<typename T>(std::span<T>& array, array_ref& ref) {
+                ref = {.offset = static_cast<std::uint64_t>(reinterpret_cast<const std::byte*>(array.data()) -
+                                                            lvl.memory.get()),
+                       .size = array.size()};
+                array = std::span(reinterpret_cast<T*>(memory + ref.offset), array.size());
+            });
+
+            relocate(arrays, reinterpret_cast<std::uintptr_t>(lvl.memory.get()), image_base, lvl.memory_size);
+            memcpy(image.data(), &header, sizeof(header));
+
+            // write to a temporary file first, so an interrupted write can't leave a broken cache file
+            std::filesystem::create_directories(path.parent_path());
+            auto temp_path = path;
+            temp_path += ".tmp";
+            {
+                const auto file = std::unique_ptr<FILE, decltype(&fclose)>(fopen(temp_path.string().c_str(), "wb"),
+                                                                         &fclose);
+                if (!file || (fwrite(image.data(), 1, image.size(), file.get()) != image.size()))
+                    throw std::runtime_error(fmt::format("Failed to write '{}'", temp_path.string()));
+            }
+
+            std::filesystem::rename(temp_path, path);
+        }
+    }
+
+    level_cache::level_cache(std::filesystem::path dir, core::thread_pool& pool) : dir_(std::move(dir)), pool_(pool)
+    {
+    }
+
+    level_t level_cache::load(core::game_data& data, const rndr::system& renderer, const std::string& lump_name,
+                              const std::string& sky_name, load_timings* timings) const
+    {
+        if (timings != nullptr) timings->clear();
+
+        if (dir_.empty()) return load_level(data, renderer, pool_, lump_name, sky_name, timings);
+
+        const auto label = core::lump_num(data, lump_name, core::lump_namespace::maps);
+        const auto key = level_key(data, sky_name);
+
+        // named by the key too, so switching between wad stacks doesn't overwrite the other stack's levels
+        const auto path = dir_ / fmt::format("{}-{:016x}.lvl", core::lump_key(lump_name).to_string(), key);
+        if (auto lvl = read_level(data, path, key, label)) return std::move(*lvl);
+
+        auto lvl = load_level(data, renderer, pool_, lump_name, sky_name, timings);
+        try
+        {
+            write_level(lvl, path, key);
+        }
+        catch (const std::exception& e)
+        {
+            // the cache only makes loading faster, the level can still be played without it
+            fmt::print("Could not cache level {}: {}\n", lump_name, e.what());
+        }
+
+        return lvl;
+    }
+}
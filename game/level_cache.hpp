@@ -0,0 +1,41 @@
+#pragma once
+
+#include <game/level.hpp>
+
+#include <filesystem>
+#include <string>
+
+namespace core
+{
+    struct game_data;
+    class thread_pool;
+}
+
+namespace rndr
+{
+    class system;
+}
+
+namespace game
+{
+    // Keeps the fully resolved geometry of levels on disk. A cached level is keyed by a hash of the paths, sizes
+    // and write times of the mounted wads, so it is only used while the same, unchanged wads are mounted.
+    // Loading a cached level maps the file, copies the level memory block out of it and relocates the
+    // pointers in it, nothing has to be parsed or looked up. The block isn't used in place: the level types
+    // point at each other, and the relocation is one pass over them, far cheaper than building the level.
+    class level_cache
+    {
+    public:
+        // An empty directory disables the cache. Levels that aren't cached are loaded on the thread pool.
+        level_cache(std::filesystem::path dir, core::thread_pool& pool);
+
+        // Falls back to load_level (and caches the result) if the level isn't cached or the cache is stale.
+        // The timings are left empty for a level that comes from the cache.
+        [[nodiscard]] level_t load(core::game_data& data, const rndr::system& renderer, const std::string& lump_name,
+                                   const std::string& sky_name, load_timings* timings = nullptr) const;
+
+    private:
+        std::filesystem::path dir_;
+        core::thread_pool& pool_;
+    };
+}
@@ -4,12 +4,16 @@
 
 namespace game
 {
-    system::system(const rndr::system& renderer, core::game_data& data, const core::iwad_description& iwad)
-        : renderer_(renderer), data_(data), iwad_(iwad)
+    system::system(const rndr::system& renderer, core::game_data& data, const core::iwad_description& iwad,
+                   core::thread_pool& pool, const std::filesystem::path& level_cache_dir)
+        : renderer_(renderer), data_(data), iwad_(iwad), level_cache_(level_cache_dir, pool)
     {
     }
 
-    void system::new_game(const start_parameters& p) { state_.emplace<arena>(iwad_, p, data_, renderer_); }
+    void system::new_game(const start_parameters& p)
+    {
+        state_.emplace<arena>(iwad_, p, data_, renderer_, level_cache_);
+    }
 
     void system::draw(grfx::system& gfx, core::game_data& data) const
     {
@@ -4,7 +4,9 @@
 #include <core/game_data.hpp>
 #include <game/demo_screen.hpp>
 #include <game/arena.hpp>
+#include <game/level_cache.hpp>
 
+#include <filesystem>
 #include <variant>
 
 namespace grfx
@@ -24,7 +26,8 @@ namespace game
     class system
     {
     public:
-        system(const rndr::system& renderer, core::game_data& data, const core::iwad_description& iwad);
+        system(const rndr::system& renderer, core::game_data& data, const core::iwad_description& iwad,
+               core::thread_pool& pool, const std::filesystem::path& level_cache_dir);
 
         void new_game(const start_parameters& p);
 
@@ -38,6 +41,7 @@ namespace game
         const rndr::system& renderer_;
         core::game_data& data_;
         core::iwad_description iwad_;
+        level_cache level_cache_;
         start_parameters parameters_;
         game_state state_ = demo_screen("TITLEPIC");
     };
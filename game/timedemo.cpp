@@ -0,0 +1,181 @@
+#include <game/timedemo.hpp>
+
+#include <core/game_data.hpp>
+#include <core/wad_types.hpp>
+#include <game/level.hpp>
+#include <rndr/system.hpp>
+#include <stdx/on_exit.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+namespace game
+{
+    namespace
+    {
+        using namespace ::core::literals;
+
+        constexpr auto view_height = 41_u;
+
+        // The nearest rank percentile of sorted frame times
+        frame_time percentile(const std::vector<frame_time>& sorted, const double p)
+        {
+            const auto rank = static_cast<size_t>(std::ceil(p * static_cast<double>(sorted.size())));
+            return sorted[std::clamp(rank, size_t{1}, sorted.size()) - 1];
+        }
+    }
+
+    camera_path read_camera_path(const std::filesystem::path& path)
+    {
+        auto file = std::ifstream(path);
+        if (!file) throw std::runtime_error(fmt::format("Failed to open camera path '{}'", path.string()));
+
+        auto result = camera_path();
+        auto line = std::string();
+        for (auto line_num = 1; std::getline(file, line); ++line_num)
+        {
+            if (line.empty() || line.starts_with('#')) continue;
+
+            auto x = 0.0F;
+            auto y = 0.0F;
+            auto z = 0.0F;
+            auto angle = 0.0F;
+            if (!(std::istringstream(line) >> x >> y >> z >> angle))
+            {
+                throw std::runtime_error(
+                    fmt::format("Line {} of camera path '{}' isn't 'x y z angle'", line_num, path.string()));
+            }
+
+            const auto position = core::pos{.x = core::units(x), .y = core::units(y)};
+            result.push_back(
+                {.position = position, .z = core::units(z), .angle = core::radians::from_degrees(angle), .mom = {}});
+        }
+
+        if (result.empty()) throw std::runtime_error(fmt::format("Camera path '{}' is empty", path.string()));
+
+        return result;
+    }
+
+    camera_path scripted_camera_path(core::game_data& data, const level_t& level, const std::string& lump_name,
+                                     const size_t num_frames)
+    {
+        const auto label = core::lump_num(data, lump_name, core::lump_namespace::maps);
+        const auto things = core::cache_lump_num_as_span<core::map_thing_t>(
+            data, label + static_cast<size_t>(core::map_lump::things), core::purge_tag::purgeable);
+        const auto start = std::ranges::find(things, short{1}, &core::map_thing_t::type);
+        if (start == things.end()) throw std::runtime_error(fmt::format("{} has no player start", lump_name));
+
+        const auto position = core::pos{.x = core::units(start->x), .y = core::units(start->y)};
+        const auto z = sub_sector_containing_point(level, position).sector->floor_height + view_height;
+
+        auto result = camera_path(num_frames);
+        for (size_t i = 0; i < num_frames; ++i)
+        {
+            const auto degrees = static_cast<real>(start->angle) +
+                                 real{360} * static_cast<real>(i) / static_cast<real>(num_frames);
+            result[i] = {.position = position, .z = z, .angle = core::radians::from_degrees(degrees), .mom = {}};
+        }
+
+        return result;
+    }
+
+    std::vector<frame_time> run_timedemo(const rndr::system& renderer, core::game_data& data, const level_t& level,
+                                         const camera_path& path, const rndr::framebuffer_view& target,
+                                         const std::function<void()>& present)
+    {
+        auto result = std::vector<frame_time>();
+        if (path.empty()) return result;
+
+        result.reserve(path.size());
+
+        // the next frame is recorded while the current one is rasterized and presented
+        auto commands = std::array<rndr::draw_commands, 2>();
+        auto start = std::chrono::steady_clock::now();
+        renderer.record(level, path[0], data, commands[0]);
+        for (size_t i = 0; i < path.size(); ++i)
+        {
+            auto next = std::future<void>();
+            {
+                const auto wait_for_next = stdx::on_exit([&] {
+                    if (next.valid()) next.wait();
+                });
+
+                if (i + 1 < path.size()) next = renderer.record_async(level, path[i + 1], data, commands[(i + 1) % 2]);
+
+                renderer.rasterize(commands[i % 2], target);
+                if (present) present();
+            }
+
+            if (next.valid()) next.get();
+
+            const auto end = std::chrono::steady_clock::now();
+            result.emplace_back(end - start);
+            start = end;
+
+            // only the commands of the next frame still point into the cache
+            data.cache.release_evicted();
+        }
+
+        return result;
+    }
+
+    std::uint64_t hash_frames(const rndr::system& renderer, core::game_data& data, const level_t& level,
+                              const camera_path& path, const rndr::framebuffer_view& target)
+    {
+        if (target.layout != rndr::framebuffer_layout::row_major)
+            throw std::invalid_argument("Only row major frames can be hashed");
+
+        // FNV-1a
+        auto hash = std::uint64_t{0xcbf29ce484222325};
+        for (const auto& pose : path)
+        {
+            renderer.draw(level, pose, data, target);
+            for (auto y = 0; y < target.height; ++y)
+            {
+                for (const auto pixel : target.row(y))
+                    hash = (hash ^ pixel) * 0x100000001b3;
+            }
+
+            data.cache.release_evicted();
+        }
+
+        return hash;
+    }
+
+    frame_time_stats get_frame_time_stats(const std::vector<frame_time>& frame_times)
+    {
+        if (frame_times.empty()) return {};
+
+        auto sorted = frame_times;
+        std::ranges::sort(sorted);
+
+        auto total = frame_time();
+        for (const auto t : frame_times)
+            total += t;
+
+        return {.average_fps = static_cast<double>(frame_times.size()) / std::chrono::duration<double>(total).count(),
+                .p50 = percentile(sorted, 0.50),
+                .p95 = percentile(sorted, 0.95),
+                .p99 = percentile(sorted, 0.99),
+                .max = sorted.back()};
+    }
+
+    void write_frame_times(const std::vector<frame_time>& frame_times, const std::filesystem::path& path)
+    {
+        const auto file = std::unique_ptr<FILE, decltype(&fclose)>(fopen(path.string().c_str(), "w"), &fclose);
+        if (!file) throw std::runtime_error(fmt::format("Failed to open '{}'", path.string()));
+
+        fmt::print(file.get(), "frame,ms\n");
+        for (size_t i = 0; i < frame_times.size(); ++i)
+            fmt::print(file.get(), "{},{:.4f}\n", i, frame_times[i].count());
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <game/mobj.hpp>
+#include <rndr/framebuffer.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace core
+{
+    struct game_data;
+}
+
+namespace rndr
+{
+    class system;
+}
+
+namespace game
+{
+    struct level_t;
+
+    // The pose of the player for every frame of a timedemo
+    using camera_path = std::vector<mobj_t>;
+
+    // One pose per line: x y z angle, with the angle in degrees. Empty lines and lines starting with # are
+    // skipped.
+    camera_path read_camera_path(const std::filesystem::path& path);
+
+    // Turns once around at the first player start of the map, so every direction gets drawn
+    camera_path scripted_camera_path(core::game_data& data, const level_t& level, const std::string& lump_name,
+                                     const size_t num_frames);
+
+    using frame_time = std::chrono::duration<double, std::milli>;
+
+    // Draws the level from every pose of the path as fast as possible, recording each frame while the one
+    // before it is rasterized. present is called after each frame and its time counts towards the frame's.
+    std::vector<frame_time> run_timedemo(const rndr::system& renderer, core::game_data& data, const level_t& level,
+                                         const camera_path& path, const rndr::framebuffer_view& target,
+                                         const std::function<void()>& present = {});
+
+    // Draws the level from every pose of the path, one frame after the other, and hashes the pixels of all
+    // frames. Renderers that draw the same pixels give the same hash. The target has to be row major.
+    std::uint64_t hash_frames(const rndr::system& renderer, core::game_data& data, const level_t& level,
+                              const camera_path& path, const rndr::framebuffer_view& target);
+
+    struct frame_time_stats
+    {
+        double average_fps = 0;
+        frame_time p50{};
+        frame_time p95{};
+        frame_time p99{};
+        frame_time max{};
+    };
+
+    frame_time_stats get_frame_time_stats(const std::vector<frame_time>& frame_times);
+
+    // One line per frame: the frame number and its time in milliseconds
+    void write_frame_times(const std::vector<frame_time>& frame_times, const std::filesystem::path& path);
+}
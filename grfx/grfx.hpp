@@ -8,6 +8,4 @@ namespace grfx
     constexpr auto palette_size = 256;
 
     using pixel_t = std::uint8_t;
-
-    extern std::span<pixel_t> video_buffer;  // todo - it's got to go
 }
\ No newline at end of file
@@ -8,7 +8,8 @@
 
 namespace grfx
 {
-#pragma pack(push, 1)
+    // Not packed, its fields line up without padding anyway. That keeps the column offsets aligned, so
+    // they can be handed out as a span, and makes cache_lump_num copy patches that start misaligned.
     struct patch_t
     {
         short width;              // bounding box width
@@ -17,7 +18,7 @@ namespace grfx
         short top_offset;         // pixels below the origin
         int first_column_offset;  // only [width] used the [0] is &column_offsets[width]
     };
-#pragma pack(pop)
+    static_assert(sizeof(patch_t) == 12);
 
     struct post_t
     {
@@ -2,10 +2,10 @@
 
 namespace grfx
 {
-    std::span<pixel_t> video_buffer;
-
     namespace
     {
+        using namespace ::core::literals;
+
         auto get_window_position(const int display_index, const int window_width, const int window_height)
         {
             if (display_index < 0 || display_index >= SDL_GetNumVideoDisplays())
@@ -198,15 +198,12 @@ namespace grfx
                                    &SDL_DestroyTexture);
 
         create_upscaled_texture();
-
-        video_buffer = std::span(static_cast<pixel_t*>(screen_buffer_->pixels),
-                                 static_cast<size_t>(screen_size_.width * screen_height));
     }
 
     void sdl_system::load_and_set_palette(core::game_data& data)
     {
         using raw_color = std::array<uint8_t, 3>;
-        const auto raw_palette = std::span(core::cache_lump<raw_color>(data, "PLAYPAL"), palette_size);
+        const auto raw_palette = std::span(core::cache_lump<raw_color>(data, "PLAYPAL"_lump), palette_size);
         std::ranges::transform(raw_palette, palette_.begin(),
                                [](const raw_color& c) { return SDL_Color{.r = c[0], .g = c[1], .b = c[2]}; });
 
@@ -19,6 +19,9 @@ namespace grfx
 
         auto screen_size() const { return platform_.screen_size(); }
 
+        // screen_size().width pixels per row
+        std::span<pixel_t> video_buffer() const { return raw_video_buffer_; }
+
     private:
         sdl_system platform_;
 
@@ -1,16 +1,28 @@
 
 #include <core/event.hpp>
 #include <core/game_data.hpp>
+#include <core/thread_pool.hpp>
 #include <doomkeys.hpp>
+#include <game/level_cache.hpp>
 #include <game/system.hpp>
+#include <game/timedemo.hpp>
 #include <grfx/system.hpp>
 #include <menu/system.hpp>
+#include <rndr/number.hpp>
+#include <rndr/rasterizer.hpp>
 #include <rndr/system.hpp>
 
 #include <fmt/format.h>
 #include <SDL_filesystem.h>
 
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <optional>
 #include <span>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace
 {
@@ -111,15 +123,167 @@ namespace
                 game_sys.handle_event(*e);
         }
     }
+
+    bool has_arg(const std::span<char*> args, const std::string_view name)
+    {
+        return std::ranges::find(args, name) != args.end();
+    }
+
+    std::optional<std::string> arg_value(const std::span<char*> args, const std::string_view name)
+    {
+        const auto arg = std::ranges::find(args, name);
+        if (arg == args.end()) return std::nullopt;
+
+        if (std::next(arg) == args.end()) throw std::runtime_error(fmt::format("{} needs a value", name));
+
+        return *std::next(arg);
+    }
+
+    size_t positive_arg_value(const std::span<char*> args, const std::string_view name, const std::string& fallback)
+    {
+        const auto value = arg_value(args, name).value_or(fallback);
+        const auto* const end = value.data() + value.size();
+        auto result = size_t{0};
+        const auto [last, error] = std::from_chars(value.data(), end, result);
+        if ((error != std::errc()) || (last != end) || (result == 0))
+        {
+            throw std::runtime_error(fmt::format("{} needs a positive number, not {}", name, value));
+        }
+
+        return result;
+    }
+
+    // Draws the camera path serially and in strips, with the scalar span drawer and with the best one the CPU
+    // has, and throws unless they all draw exactly the same frames
+    void check_identical_frames(core::game_data& data, core::thread_pool& pool, const game::level_t& level,
+                                const game::camera_path& path)
+    {
+        auto drawers = std::vector{rndr::span_drawer::scalar};
+        if (rndr::best_span_drawer() != rndr::span_drawer::scalar) drawers.push_back(rndr::best_span_drawer());
+
+        auto framebuffer = rndr::framebuffer(grfx::original_screen_width, grfx::original_screen_height);
+        auto hashes = std::vector<std::uint64_t>();
+        for (const auto mode : {rndr::render_mode::serial, rndr::render_mode::strips})
+        {
+            const auto renderer = rndr::system(data, pool, rndr::texture_setup::lazy, mode);
+            for (const auto drawer : drawers)
+            {
+                rndr::use_span_drawer(drawer);
+                hashes.push_back(game::hash_frames(renderer, data, level, path, framebuffer.view()));
+                fmt::print("{} renderer, {} spans: frame hash {:016x}\n",
+                           (mode == rndr::render_mode::serial) ? "serial" : "strips",
+                           (drawer == rndr::span_drawer::scalar) ? "scalar" : "AVX2", hashes.back());
+            }
+        }
+
+        if (!std::ranges::all_of(hashes, [&](const auto hash) { return hash == hashes.front(); }))
+            throw std::runtime_error("The renderers drew different frames");
+
+        fmt::print("all {} frames are identical\n", path.size());
+    }
+
+    // -timedemo <map> [-camera <file>] [-frames <n>] [-nopresent] [-columnmajor] [-csv <file>] [-checkidentical]
+    //           [-sanitized]
+    //
+    // Draws the map from every pose of the camera path (or from a turn around the player start) as fast as
+    // possible and reports the frame times. With -nopresent the frames are drawn into a framebuffer of their
+    // own and no window is opened. With -columnmajor the frames are drawn column major and transposed when
+    // they are presented. -checkidentical doesn't time anything, it checks that drawing serially and in strips,
+    // with and without SIMD, gives the same frames. A build with AddressSanitizer (DOOM_SANITIZE) refuses to time
+    // frames unless -sanitized is given, its frame times say nothing about the renderer.
+    void run_timedemo(const std::span<char*> args, const std::string& map, const core::configuration& config,
+                      core::game_data& data, core::thread_pool& pool, const rndr::system& renderer)
+    {
+        const auto levels = game::level_cache(std::filesystem::path(config.dir) / "levels", pool);
+        data.cache.purge_level();
+        const auto level = levels.load(data, renderer, map, game::sky_texture_name(map));
+        const auto precache = renderer.precache_level(level, data);
+
+        const auto camera = arg_value(args, "-camera");
+        const auto num_frames = positive_arg_value(args, "-frames", "1000");
+        const auto path =
+            camera ? game::read_camera_path(*camera) : game::scripted_camera_path(data, level, map, num_frames);
+
+        if (has_arg(args, "-checkidentical"))
+        {
+            check_identical_frames(data, pool, level, path);
+            return;
+        }
+
+#ifdef DOOM_SANITIZED
+        if (!has_arg(args, "-sanitized"))
+        {
+            throw std::runtime_error("This build uses AddressSanitizer, which makes its frame times meaningless. "
+                                     "Configure with -DDOOM_SANITIZE=OFF to time the renderer, or pass -sanitized "
+                                     "to run the timedemo anyway");
+        }
+
+        fmt::print("WARNING: this build uses AddressSanitizer, the frame times are not representative\n");
+#endif
+
+        const auto is_column_major = has_arg(args, "-columnmajor");
+        auto column_major = rndr::framebuffer(grfx::original_screen_width, grfx::original_screen_height,
+                                              rndr::framebuffer_layout::column_major);
+
+        auto frame_times = std::vector<game::frame_time>();
+        if (has_arg(args, "-nopresent"))
+        {
+            auto framebuffer = rndr::framebuffer(grfx::original_screen_width, grfx::original_screen_height);
+            if (is_column_major)
+            {
+                frame_times = game::run_timedemo(renderer, data, level, path, column_major.view(),
+                                                 [&] { rndr::transpose(column_major.view(), framebuffer.view()); });
+            }
+            else
+            {
+                frame_times = game::run_timedemo(renderer, data, level, path, framebuffer.view());
+            }
+        }
+        else
+        {
+            auto gfx_sys = grfx::system({}, data);
+            const auto screen = game::screen_view(gfx_sys);
+            frame_times = game::run_timedemo(renderer, data, level, path, is_column_major ? column_major.view() : screen,
+                                             [&] {
+                                                 if (is_column_major) rndr::transpose(column_major.view(), screen);
+                                                 gfx_sys.update();
+                                                 SDL_PumpEvents();
+                                             });
+        }
+
+        const auto stats = game::get_frame_time_stats(frame_times);
+        fmt::print("timedemo {} ({} renderer): {} frames, {:.1f} fps average, frame times p50 {:.3f} ms, "
+                   "p95 {:.3f} ms, p99 {:.3f} ms, max {:.3f} ms\n",
+                   map, rndr::number_name, frame_times.size(), stats.average_fps, stats.p50.count(), stats.p95.count(),
+                   stats.p99.count(), stats.max.count());
+        fmt::print("precached {} textures ({} KiB of columns) and {} flats ({} KiB in the lump cache)\n",
+                   precache.num_textures, precache.texture_bytes / 1024, precache.num_flats,
+                   precache.flat_bytes / 1024);
+
+        const auto default_csv = std::filesystem::path(config.dir) / "timedemo.csv";
+        const auto csv = arg_value(args, "-csv").value_or(default_csv.string());
+        game::write_frame_times(frame_times, csv);
+        fmt::print("frame times written to {}\n", csv);
+
+#ifdef DOOM_SANITIZED
+        fmt::print("WARNING: these frame times were measured with AddressSanitizer\n");
+#endif
+    }
 }
 
-int main()
+int main(int argc, char* argv[])
 {
     try
     {
         fmt::print("doom++ : a C++ implementation of the original classic first person shooter\n");
 
-        const auto config = core::configuration{.dir = default_config_dir()};
+        const auto args = std::span(argv, static_cast<size_t>(argc)).subspan(1);
+
+        // -lumpbudget <bytes> caps the memory of the lumps read from stdio wads
+        const auto config = core::configuration{.dir = default_config_dir(),
+                                                .lump_cache_budget = has_arg(args, "-lumpbudget")
+                                                                         ? positive_arg_value(args, "-lumpbudget", "")
+                                                                         : core::lump_cache::unlimited};
         fmt::print("config dir: {}\n", config.dir);
 
         // todo load config & bind keys
@@ -132,10 +296,27 @@ int main()
 
         core::game_data data;
         add_wad_file(iwad_path, data);
+        data.cache.set_budget(config.lump_cache_budget);
 
-        auto rndr_sys = rndr::system(data);
+        auto pool = core::thread_pool();
 
-        auto game_sys = game::system(rndr_sys, data, iwad);
+        // -nosimd draws floor and ceiling spans without the AVX2 span drawer
+        if (has_arg(args, "-nosimd")) rndr::use_span_drawer(rndr::span_drawer::scalar);
+
+        // -serialrender draws every frame on the main thread
+        const auto render_mode = has_arg(args, "-serialrender") ? rndr::render_mode::serial : rndr::render_mode::strips;
+
+        // -sortbytexture sorts the draw commands of every frame by texture before they are rasterized
+        const auto command_order =
+            has_arg(args, "-sortbytexture") ? rndr::command_order::by_texture : rndr::command_order::recorded;
+        auto rndr_sys = rndr::system(data, pool, rndr::texture_setup::lazy, render_mode, command_order);
+        if (const auto map = arg_value(args, "-timedemo"))
+        {
+            run_timedemo(args, *map, config, data, pool, rndr_sys);
+            return 0;
+        }
+
+        auto game_sys = game::system(rndr_sys, data, iwad, pool, std::filesystem::path(config.dir) / "levels");
 
         auto menu_sys = menu::system(iwad, game_sys);
 
@@ -154,6 +335,9 @@ int main()
 
             menu_sys.draw(gfx_sys, data);
             gfx_sys.update();
+
+            // nothing holds on to purgeable lumps between frames
+            data.cache.release_evicted();
         }
     }
     catch (std::exception& e)
@@ -15,6 +15,7 @@ namespace menu
 {
     namespace
     {
+        using namespace ::core::literals;
         using namespace ::std::string_view_literals;
 
         constexpr auto line_height = 16;
@@ -55,22 +56,22 @@ namespace menu
 
         void draw_main_menu(grfx::system& gfx, core::game_data& data)
         {
-            gfx.draw_patch(94, 2, *core::cache_lump<grfx::patch_t>(data, "M_DOOM"));
+            gfx.draw_patch(94, 2, *core::cache_lump<grfx::patch_t>(data, "M_DOOM"_lump, core::purge_tag::purgeable));
         }
 
         void draw_help_page_1(grfx::system& gfx, core::game_data& data)
         {
-            gfx.draw_patch(0, 0, *core::cache_lump<grfx::patch_t>(data, "HELP2"));
+            gfx.draw_patch(0, 0, *core::cache_lump<grfx::patch_t>(data, "HELP2"_lump, core::purge_tag::purgeable));
         }
 
         void draw_help_page_2(grfx::system& gfx, core::game_data& data)
         {
-            gfx.draw_patch(0, 0, *core::cache_lump<grfx::patch_t>(data, "HELP1"));
+            gfx.draw_patch(0, 0, *core::cache_lump<grfx::patch_t>(data, "HELP1"_lump, core::purge_tag::purgeable));
         }
 
         void draw_choose_episode_page(grfx::system& gfx, core::game_data& data)
         {
-            gfx.draw_patch(54, 38, *core::cache_lump<grfx::patch_t>(data, "M_EPISOD"));
+            gfx.draw_patch(54, 38, *core::cache_lump<grfx::patch_t>(data, "M_EPISOD"_lump, core::purge_tag::purgeable));
         }
 
         auto main_page = menu_page{
@@ -212,13 +213,17 @@ namespace menu
         for (auto y = current_page_->y; const auto& item : current_page_->items)
         {
             if (!item.name.empty())
-                gfx.draw_patch(current_page_->x, y, *core::cache_lump<grfx::patch_t>(data, item.name));
+            {
+                gfx.draw_patch(current_page_->x, y,
+                               *core::cache_lump<grfx::patch_t>(data, item.name, core::purge_tag::purgeable));
+            }
 
             y += line_height;
         }
 
         gfx.draw_patch(current_page_->x + skull_x_offset, current_page_->y - 5 + selected_item_index_ * line_height,
-                       *core::cache_lump<grfx::patch_t>(data, skull_names[current_skull_]));
+                       *core::cache_lump<grfx::patch_t>(data, skull_names[current_skull_],
+                                                        core::purge_tag::purgeable));
     }
 
     void system::message(const std::string_view text, void (*routine)(system&, int), bool is_input_required)
@@ -4,12 +4,15 @@
 #include <core/wad_types.hpp>
 #include <game/level.hpp>
 #include <rndr/column.hpp>
+#include <rndr/draw_commands.hpp>
+#include <rndr/number.hpp>
+#include <rndr/solid_columns.hpp>
 #include <rndr/texture_info.hpp>
 #include <rndr/trigonometry.hpp>
 #include <rndr/visplane.hpp>
-#include <stdx/on_exit.hpp>
 
 #include <array>
+#include <concepts>
 #include <span>
 
 namespace rndr
@@ -20,7 +23,8 @@ namespace rndr
 
         constexpr auto max_wall_scale = real{64};
         constexpr auto max_num_openings = grfx::max_screen_width * 64 * 4;
-        constexpr auto texture_factor = real{16};
+        constexpr auto texture_bits = 4;
+        constexpr auto texture_factor = real{1 << texture_bits};
 
         struct visplane_indices_t
         {
@@ -32,14 +36,17 @@ namespace rndr
         {
             int x = 0;
             int stop_x = 0;
-            core::radians center_angle;
+            // scale is the one at origin_x, the first column of the whole seg, so a column's scale doesn't
+            // depend on how the seg got clipped
+            int origin_x = 0;
+            core::bam center_angle;
             core::units offset;
             core::units distance;
             real scale{};
             real scale_step{};
-            real mid_texture_mid{};
-            real top_texture_mid{};
-            real bottom_texture_mid{};
+            number mid_texture_mid{};
+            number top_texture_mid{};
+            number bottom_texture_mid{};
             const std::array<std::span<const light_table_t>, num_light_scales>* lights = nullptr;
         };
 
@@ -60,30 +67,27 @@ namespace rndr
             core::units world_high;
             core::units world_low;
 
-            core::units pix_high;
-            core::units pix_low;
-
-            core::units pix_high_step;
-            core::units pix_low_step;
-
-            core::units top_fraction;
-            core::units top_step;
-
-            core::units bottom_fraction;
-            core::units bottom_step;
-
             visplane_indices_t plane_indices;
         };
 
         auto to_tex_coord(const auto& x) { return x / texture_factor; }
 
-        auto from_tex_coord(const auto& x) { return x * texture_factor; }
+        // The screen row of a height in texture coordinates. Fixed point numbers shift like HEIGHTBITS did in
+        // the original, because the heights of walls close to the view would overflow if they got multiplied.
+        template <typename Number>
+        int tex_coord_to_y(const Number x)
+        {
+            if constexpr (std::same_as<Number, core::fixed>)
+                return x.raw_value() >> (core::fixed::fraction_bits - texture_bits);
+            else
+                return static_cast<int>(x * static_cast<Number>(texture_factor));
+        }
 
         real scale_from_global_angle(const context_t& context, const core::units wall_distance,
-                                     const core::radians wall_normal_angle, core::radians vis_angle)
+                                     const core::bam wall_normal_angle, const core::bam vis_angle)
         {
-            const auto angle_a = core::half_pi + vis_angle - context.frame.angle;
-            const auto angle_b = core::half_pi + vis_angle - wall_normal_angle;
+            const auto angle_a = core::ang90 + vis_angle - context.frame.angle;
+            const auto angle_b = core::ang90 + vis_angle - wall_normal_angle;
             const auto den = wall_distance * sin(angle_a);
             const auto num = core::units(static_cast<real>(context.view.projection)) * sin(angle_b);
 
@@ -92,34 +96,35 @@ namespace rndr
             return std::clamp(num / den, real(0.0039), max_wall_scale);
         }
 
-        std::optional<std::pair<core::radians, core::radians>> clipped_angle_interval(const core::pos p1,
-                                                                                      const core::pos p2,
-                                                                                      const frame_t& frame,
-                                                                                      const core::radians clip_angle)
+        // the angles wrap around, so none of them need normalizing
+        std::optional<std::pair<core::bam, core::bam>> clipped_angle_interval(const core::pos p1, const core::pos p2,
+                                                                              const frame_t& frame,
+                                                                              const core::bam clip_angle)
         {
-            auto a1 = normalize(point_to_angle(frame, p1) - frame.angle);
-            auto a2 = normalize(point_to_angle(frame, p2) - frame.angle);
+            auto a1 = point_to_angle(frame, p1) - frame.angle;
+            auto a2 = point_to_angle(frame, p2) - frame.angle;
 
-            const auto interval = normalize(a1 - a2);
+            const auto interval = a1 - a2;
 
             // Sitting on a line?
-            if (interval >= core::pi) return std::nullopt;
+            if (interval >= core::ang180) return std::nullopt;
 
-            if (const auto a1_rot = normalize(a1 + clip_angle); a1_rot > 2.0 * clip_angle)
+            const auto view_range = clip_angle + clip_angle;
+            if (const auto a1_rot = a1 + clip_angle; a1_rot > view_range)
             {
                 // Totally off the left edge?
-                if (normalize(a1_rot - 2.0 * clip_angle) >= interval) return {};
+                if (a1_rot - view_range >= interval) return {};
 
                 a1 = clip_angle;
             }
 
-            if (!((a2 > (core::two_pi - clip_angle)) || (a2 < clip_angle))) a2 = core::two_pi - clip_angle;
+            if (!((a2 > -clip_angle) || (a2 < clip_angle))) a2 = -clip_angle;
 
             return std::pair(a1, a2);
         }
 
-        bool check_bounding_box(const int view_width, const core::radians clip_angle, const frame_t& frame,
-                                const clip_range_array& solid_segs, const game::bounding_box_t& box)
+        bool check_bounding_box(const view_t& view, const frame_t& frame, const solid_columns& solid_segs,
+                                const game::bounding_box_t& box)
         {
             // Find the corners of the box
             // that define the edges from current viewpoint.
@@ -149,29 +154,26 @@ namespace rndr
             const auto x2 = box.*check_coord[box_pos][2];
             const auto y2 = box.*check_coord[box_pos][3];
 
-            const auto angle_range = clipped_angle_interval({x1, y1}, {x2, y2}, frame, clip_angle);
+            const auto angle_range = clipped_angle_interval({x1, y1}, {x2, y2}, frame, view.clip_angle);
             if (!angle_range) return false;
 
             const auto [angle1, angle2] = *angle_range;
-            if (normalize(angle1 - angle2) >= core::pi) return true;
+            if (angle1 - angle2 >= core::ang180) return true;
 
-            // Find the first clip post
-            //  that touches the source post
-            //  (adjacent pixels are touching).
-            const auto sx1 = view_angle_to_x(view_width, clip_angle, angle1);
-            const auto sx2 = view_angle_to_x(view_width, clip_angle, angle2) - 1;
+            const auto sx1 = view_angle_to_x(view, angle1);
+            const auto sx2 = view_angle_to_x(view, angle2) - 1;
 
             // Does not cross a pixel.
             if (sx1 == (sx2 + 1)) return false;
 
-            const auto cr = *solid_segs.first_touching(sx2);
-            return !(sx1 >= cr.first && sx2 <= cr.last);
+            // Hidden behind a solid wall?
+            return !solid_segs.is_covered(sx1, sx2);
         }
 
         int texture_translation(int x) { return x; }
 
-        std::pair<int, int> mark_floors_and_ceilings(const int x, const core::units bottom_fraction,
-                                                     const core::units top_fraction, const std::span<int> floor_clip,
+        std::pair<int, int> mark_floors_and_ceilings(const int x, const number bottom_fraction,
+                                                     const number top_fraction, const std::span<int> floor_clip,
                                                      const std::span<int> ceiling_clip, const draw_texture_t& dt,
                                                      visplanes& planes)
         {
@@ -181,28 +183,29 @@ namespace rndr
                 if (top <= bottom) planes.set_extents(plane_index, x, bottom, top);
             };
 
-            const auto wall_top = std::max(static_cast<int>(from_tex_coord(top_fraction)), ceiling_clip[x]) + 1;
+            const auto wall_top = std::max(tex_coord_to_y(top_fraction), ceiling_clip[x]) + 1;
             if (dt.is_ceiling) add_plane(wall_top, ceiling_clip[x], dt.plane_indices.ceiling_index);
 
-            const auto wall_bottom = std::min(static_cast<int>(from_tex_coord(bottom_fraction)), floor_clip[x] - 1);
+            const auto wall_bottom = std::min(tex_coord_to_y(bottom_fraction), floor_clip[x] - 1);
             if (dt.is_floor) add_plane(floor_clip[x], wall_bottom, dt.plane_indices.floor_index);
 
             return {wall_top, wall_bottom};
         }
 
-        void draw_col(const context_t& context, const int start, const int end, const real texture_mid,
-                      const int texture_index, const int texture_column, draw_column_t& dc)
+        void draw_col(const context_t& context, const int start, const int end, const number texture_mid,
+                      const int texture_index, const int texture_column, draw_column_t& dc, draw_commands& commands)
         {
             dc.y_start = start;
             dc.y_end = end;
             dc.texture_mid = texture_mid;
             dc.source = get_column(context, texture_index, texture_column);
-            draw_column(context.view, dc);
+            add_column_command(context, dc, commands);
         }
 
         void draw_two_sided_column_piece(const context_t& context, const int texture_index, const int texture_column,
-                                         const real texture_mid, const bool clip_at_bottom, const int plane_y,
-                                         const bool has_plane, int& clip_value, draw_column_t& dc, const auto get_mid_y)
+                                         const number texture_mid, const bool clip_at_bottom, const int plane_y,
+                                         const bool has_plane, int& clip_value, draw_column_t& dc,
+                                         draw_commands& commands, const auto get_mid_y)
         {
             if (texture_index)
             {
@@ -211,7 +214,7 @@ namespace rndr
                 const auto end = clip_at_bottom ? mid_y : plane_y - 1;
                 if (start <= end)
                 {
-                    draw_col(context, start, end, texture_mid, texture_index, texture_column, dc);
+                    draw_col(context, start, end, texture_mid, texture_index, texture_column, dc, commands);
                     clip_value = clip_at_bottom ? end : start;
                 }
                 else
@@ -237,7 +240,7 @@ namespace rndr
                 if (back_ceiling_height < front_ceiling_height)
                 {
                     const auto is_pegged = (line.line_def->flags & core::line_def_flags::dont_peg_top) == 0;
-                    wall.top_texture_mid = static_cast<real>(
+                    wall.top_texture_mid = to_number(
                         line.side_def->row_offset
                         + (is_pegged ? (back_ceiling_height + context.texture_info.height[line.side_def->top_texture])
                                      : front_ceiling_height));
@@ -247,14 +250,14 @@ namespace rndr
                 if (back_floor_height > front_floor_height)
                 {
                     const auto is_pegged = (line.line_def->flags & core::line_def_flags::dont_peg_bottom) == 0;
-                    wall.bottom_texture_mid = static_cast<real>(
+                    wall.bottom_texture_mid = to_number(
                         line.side_def->row_offset + (is_pegged ? back_floor_height : front_ceiling_height));
                 }
             }
             else
             {
                 const auto is_pegged = (line.line_def->flags & core::line_def_flags::dont_peg_bottom) == 0;
-                wall.mid_texture_mid = static_cast<real>(
+                wall.mid_texture_mid = to_number(
                     line.side_def->row_offset
                     + (is_pegged ? front_ceiling_height
                                  : front_floor_height + context.texture_info.height[line.side_def->mid_texture]));
@@ -325,6 +328,12 @@ namespace rndr
             if ((front_sector.ceiling_height <= context.frame.z) && !is_sector_outdoors(front_sector))
                 dt.is_ceiling = false;
 
+            // once for the seg, so drawing its columns doesn't have to check for every column
+            for (const auto texture : {dt.mid_texture, dt.top_texture, dt.bottom_texture})
+            {
+                if (texture != 0) ensure_columns(context.data, texture, context.texture_info);
+            }
+
             return dt;
         }
 
@@ -337,28 +346,30 @@ namespace rndr
             return std::clamp(light_num + x_offset + y_offset, 0, light_levels - 1);
         }
 
-        draw_seg_t segment_drawing_information(const context_t& context, const game::seg_t& line, const int first,
-                                               const int last, const core::radians wall_normal_angle,
-                                               const core::units wall_distance)
+        // The scale is interpolated between the ends of the whole seg rather than the ends of the visible
+        // range, so the columns get the same scale however the seg is split up
+        void set_wall_scale(const context_t& context, const clip_range_t& extent,
+                            const core::bam wall_normal_angle, regular_wall_t& wall)
         {
-            draw_seg_t ds{.line = &line, .x1 = first, .x2 = last};
+            const auto scale_at = [&](const int x) {
+                const auto angle = x_to_view_angle(context.view, x);
+                return scale_from_global_angle(context, wall.distance, wall_normal_angle, context.frame.angle + angle);
+            };
 
-            // calculate scale at both ends and step
-            const auto first_angle = x_to_view_angle(context.view.width, context.view.clip_angle, first);
-            ds.scale1 =
-                scale_from_global_angle(context, wall_distance, wall_normal_angle, context.frame.angle + first_angle);
+            wall.origin_x = extent.first;
+            wall.scale = scale_at(extent.first);
+            if (extent.last > extent.first)
+                wall.scale_step = (scale_at(extent.last) - wall.scale) / static_cast<real>(extent.last - extent.first);
+        }
 
-            if (last > first)
-            {
-                const auto last_angle = x_to_view_angle(context.view.width, context.view.clip_angle, last);
-                ds.scale2 =
-                    scale_from_global_angle(context, wall_distance, wall_normal_angle, context.frame.angle + last_angle);
-                ds.scale_step = (ds.scale2 - ds.scale1) / static_cast<real>(last - first);
-            }
-            else
-            {
-                ds.scale2 = ds.scale1;
-            }
+        draw_seg_t segment_drawing_information(const game::seg_t& line, const int first, const int last,
+                                               const regular_wall_t& wall)
+        {
+            draw_seg_t ds{.line = &line, .x1 = first, .x2 = last};
+
+            ds.scale1 = wall.scale + static_cast<real>(first - wall.origin_x) * wall.scale_step;
+            ds.scale2 = wall.scale + static_cast<real>(last - wall.origin_x) * wall.scale_step;
+            ds.scale_step = wall.scale_step;
 
             ds.masked_texture_col = nullptr;
 
@@ -379,7 +390,7 @@ namespace rndr
 
         void store_wall_range(const context_t& context, const visplane_indices_t& plane_indices,
                               const game::sector_t& front_sector, const game::sector_t* back_sector,
-                              const game::seg_t& line, const int first, const int last);
+                              const game::seg_t& line, const clip_range_t& extent, const int first, const int last);
 
         template <bool IsSolid>
         void clip_wall_segment(const context_t& context, const visplane_indices_t& plane_indices,
@@ -393,9 +404,9 @@ namespace rndr
 
         void render_bsp_node(const context_t& context, const int node_num);
 
-        void reset(const int view_width, const int view_height);
+        void reset(const clip_range_t& columns, const int view_height, draw_commands& frame_commands);
 
-        void draw_visplanes(const context_t& context) { visplanes_.draw(context); }
+        void draw_visplanes(const context_t& context) { visplanes_.draw(context, *commands); }
 
         void on_view_size_changed(const int view_width, const int view_height)
         {
@@ -403,7 +414,7 @@ namespace rndr
         }
 
     private:
-        clip_range_array solid_segs;
+        solid_columns solid_segs;
         std::vector<draw_seg_t> draw_segs;
         std::array<int, grfx::max_screen_width> floor_clip{};
         std::array<int, grfx::max_screen_width> ceiling_clip{};
@@ -412,19 +423,31 @@ namespace rndr
         int last_opening_index = 0;
 
         visplanes visplanes_;
+
+        // where the frame that is being rendered goes
+        draw_commands* commands = nullptr;
     };
 
     void bsp_renderer::impl::render_seg_loop(const context_t& context, const draw_texture_t& dt,
                                              const regular_wall_t& wall)
     {
+        const auto center_y_fraction = to_number(to_tex_coord(context.view.center_y_fraction));
+        const auto scale = static_cast<number>(wall.scale);
+        const auto scale_step = static_cast<number>(wall.scale_step);
+        const auto world_top = to_number(dt.world_top);
+        const auto world_bottom = to_number(dt.world_bottom);
+        const auto world_high = to_number(dt.world_high);
+        const auto world_low = to_number(dt.world_low);
+
+        // everything is worked out from the column's own scale instead of stepping along the range, which
+        // keeps the columns the same no matter which part of the wall is drawn
         int texture_column = 0;
-        auto pix_high = dt.pix_high;
-        auto pix_low = dt.pix_low;
-        auto bottom_fraction = dt.bottom_fraction;
-        auto top_fraction = dt.top_fraction;
-        auto wall_scale = wall.scale;
         for (auto x = wall.x; x < wall.stop_x; ++x)
         {
+            const auto wall_scale = scale + static_cast<number>(x - wall.origin_x) * scale_step;
+            const auto top_fraction = center_y_fraction - (world_top * wall_scale);
+            const auto bottom_fraction = center_y_fraction - (world_bottom * wall_scale);
+
             // mark floor / ceiling areas
             const auto [yl, yh] =
                 mark_floors_and_ceilings(x, bottom_fraction, top_fraction, floor_clip, ceiling_clip, dt, visplanes_);
@@ -434,22 +457,23 @@ namespace rndr
             if (dt.is_seg_textured)
             {
                 // calculate texture offset
-                const auto view_angle = x_to_view_angle(context.view.width, context.view.clip_angle, x);
-                const auto angle = wall.center_angle + view_angle - (0.5 * core::pi);
+                const auto view_angle = x_to_view_angle(context.view, x);
+                const auto angle = wall.center_angle + view_angle - core::ang90;
                 texture_column = static_cast<int>(wall.offset - (tan(angle) * wall.distance));
                 // calculate lighting
-                const auto index = std::min(static_cast<int>(wall_scale * light_scale_factor), max_light_scale);
+                const auto index =
+                    std::min(static_cast<int>(wall_scale * static_cast<number>(light_scale_factor)), max_light_scale);
 
                 dc.color_map = (*wall.lights)[index];
                 dc.x = x;
-                dc.fraction_step = real{1} / wall_scale;
+                dc.fraction_step = number{1} / wall_scale;
             }
 
             // draw the wall tiers
             if (dt.mid_texture != 0)
             {
                 // single sided line
-                draw_col(context, yl, yh, wall.mid_texture_mid, dt.mid_texture, texture_column, dc);
+                draw_col(context, yl, yh, wall.mid_texture_mid, dt.mid_texture, texture_column, dc, *commands);
                 ceiling_clip[x] = context.view.height;
                 floor_clip[x] = -1;
             }
@@ -458,20 +482,19 @@ namespace rndr
                 // two-sided line - draw the top piece...
                 draw_two_sided_column_piece(
                     context, dt.top_texture, texture_column, wall.top_texture_mid, true, yl - 1, dt.is_ceiling,
-                    ceiling_clip[x], dc, [&] {
-                        return std::min(std::min(context.view.height - 1, static_cast<int>(from_tex_coord(pix_high))),
+                    ceiling_clip[x], dc, *commands, [&] {
+                        const auto pix_high = center_y_fraction - (world_high * wall_scale);
+                        return std::min(std::min(context.view.height - 1, tex_coord_to_y(pix_high)),
                                         floor_clip[x] - 1);
                     });
-                if (dt.top_texture != 0) pix_high += dt.pix_high_step;
 
                 // ...then the bottom piece
                 draw_two_sided_column_piece(context, dt.bottom_texture, texture_column, wall.bottom_texture_mid, false,
-                                            yh + 1, dt.is_floor, floor_clip[x], dc, [&] {
-                                                return std::max(
-                                                    std::max(0, static_cast<int>(from_tex_coord(pix_low)) + 1),
-                                                    ceiling_clip[x] + 1);
+                                            yh + 1, dt.is_floor, floor_clip[x], dc, *commands, [&] {
+                                                const auto pix_low = center_y_fraction - (world_low * wall_scale);
+                                                return std::max(std::max(0, tex_coord_to_y(pix_low) + 1),
+                                                                ceiling_clip[x] + 1);
                                             });
-                if (dt.bottom_texture != 0) pix_low += dt.pix_low_step;
 
                 if (dt.is_masked_texture)
                 {
@@ -481,24 +504,24 @@ namespace rndr
                     // masked_texture_col[x] = texture_column;
                 }
             }
-
-            wall_scale += wall.scale_step;
-            bottom_fraction += dt.bottom_step;
-            top_fraction += dt.top_step;
         }
     }
 
     void bsp_renderer::impl::store_wall_range(const context_t& context, const visplane_indices_t& plane_indices,
                                               const game::sector_t& front_sector, const game::sector_t* back_sector,
-                                              const game::seg_t& line, const int first, const int last)
+                                              const game::seg_t& line, const clip_range_t& extent, const int first,
+                                              const int last)
     {
         // mark the segment as visible for auto map
         // line_def->flags |= core::line_def_flags::mapped;  // todo
-        const auto wall_normal_angle = line.angle + core::half_pi;
+        const auto wall_normal_angle = core::bam(line.angle) + core::ang90;
 
         const auto wall_distance = core::distance_from_point_to_line(context.frame.position, *line.v1, *line.v2);
 
-        auto ds = segment_drawing_information(context, line, first, last, wall_normal_angle, wall_distance);
+        regular_wall_t wall{.x = first, .stop_x = last + 1, .distance = wall_distance};
+        set_wall_scale(context, extent, wall_normal_angle, wall);
+
+        auto ds = segment_drawing_information(line, first, last, wall);
 
         auto dt = texture_drawing_information(context, *line.side_def, front_sector, back_sector);
 
@@ -509,46 +532,18 @@ namespace rndr
             last_opening_index += last - first + 1;
         }
 
-        regular_wall_t wall{.x = first, .stop_x = last + 1, .distance = wall_distance};
-        wall.scale = static_cast<real>(ds.scale1);
-        if (last > first) wall.scale_step = static_cast<real>(ds.scale_step);
-
         if (dt.is_seg_textured)
         {
             set_wall_texture_coordinates(context, front_sector, back_sector, line, wall);
             wall.offset = core::units{core::dot(context.frame.position - *line.v1, *line.v2 - *line.v1) / line.length};
             wall.offset += line.side_def->texture_offset + line.offset;
-            wall.center_angle = core::half_pi + context.frame.angle - wall_normal_angle;
+            wall.center_angle = core::ang90 + context.frame.angle - wall_normal_angle;
             wall.lights =
                 context.fixed_color_map
                     ? &context.lighting_tables.scale_light_fixed
                     : &context.lighting_tables.scale_light[light_table_index(context, front_sector, *line.v1, *line.v2)];
         }
 
-        const auto center_y_fraction = to_tex_coord(context.view.center_y_fraction);
-
-        // calculate incremental stepping values for texture edges
-        dt.top_step = -wall.scale_step * dt.world_top;
-        dt.top_fraction = center_y_fraction - (dt.world_top * wall.scale);
-
-        dt.bottom_step = -wall.scale_step * dt.world_bottom;
-        dt.bottom_fraction = center_y_fraction - (dt.world_bottom * wall.scale);
-
-        if (back_sector != nullptr)
-        {
-            if (dt.world_high < dt.world_top)
-            {
-                dt.pix_high = center_y_fraction - (dt.world_high * wall.scale);
-                dt.pix_high_step = -(wall.scale_step * dt.world_high);
-            }
-
-            if (dt.world_low > dt.world_bottom)
-            {
-                dt.pix_low = center_y_fraction - (dt.world_low * wall.scale);
-                dt.pix_low_step = -(wall.scale_step * dt.world_low);
-            }
-        }
-
         // render it
         if (dt.is_ceiling)
         {
@@ -574,62 +569,18 @@ namespace rndr
                                                const game::sector_t& front_sector, const game::sector_t* back_sector,
                                                const game::seg_t& line, const int first, const int last)
     {
-        // Find the first range that touches the range
-        //  (adjacent pixels are touching).
-        auto* start = solid_segs.first_touching(first - 1);
+        const auto extent = clip_range_t{.first = first, .last = last};
 
-        if (first < start->first)
+        // Draw every run of columns of the wall that no solid wall covers yet
+        auto x = solid_segs.first_open(first, last);
+        while (x <= last)
         {
-            if (last < start->first - 1)
-            {
-                // Post is entirely visible (above start),
-                //  so insert a new clip post.
-                store_wall_range(context, plane_indices, front_sector, back_sector, line, first, last);
-                if constexpr (IsSolid) solid_segs.insert(start, first, last);
-
-                return;
-            }
-
-            // There is a fragment above *start.
-            store_wall_range(context, plane_indices, front_sector, back_sector, line, first, start->first - 1);
+            const auto run_last = solid_segs.first_solid(x, last) - 1;
+            store_wall_range(context, plane_indices, front_sector, back_sector, line, extent, x, run_last);
+            x = solid_segs.first_open(run_last + 1, last);
         }
 
-        if constexpr (IsSolid)
-        {
-            // Now adjust the clip size.
-            if (first < start->first) start->first = first;
-        }
-
-        // Bottom contained in start?
-        if (last <= start->last) return;
-
-        auto* current = start;
-
-        const auto crunch = stdx::on_exit(std::function([&] {
-            if constexpr (IsSolid)
-                if (current != start) solid_segs.remove(std::next(start), current);
-        }));
-
-        while (last >= std::next(current)->first - 1)
-        {
-            // There is a fragment between two posts.
-            store_wall_range(context, plane_indices, front_sector, back_sector, line, current->last + 1,
-                             std::next(current)->first - 1);
-            current = std::next(current);
-
-            if (last <= current->last)
-            {
-                // Bottom is contained in next.
-                // Adjust the clip size.
-                if constexpr (IsSolid) start->last = current->last;
-                return;
-            }
-        }
-
-        // There is a fragment after *next.
-        store_wall_range(context, plane_indices, front_sector, back_sector, line, current->last + 1, last);
-        // Adjust the clip size.
-        if constexpr (IsSolid) start->last = last;
+        if constexpr (IsSolid) solid_segs.insert(first, last);
     }
 
     void bsp_renderer::impl::render_line(const context_t& context, const visplane_indices_t& plane_indices,
@@ -639,12 +590,12 @@ namespace rndr
         if (!angle_range) return;
 
         const auto [angle1, angle2] = *angle_range;
-        if (normalize(angle1 - angle2) >= core::pi) return;
+        if (angle1 - angle2 >= core::ang180) return;
 
         // The seg is in the view range,
         // but not necessarily visible.
-        const auto x1 = view_angle_to_x(context.view.width, context.view.clip_angle, angle1);
-        const auto x2 = view_angle_to_x(context.view.width, context.view.clip_angle, angle2);
+        const auto x1 = view_angle_to_x(context.view, angle1);
+        const auto x2 = view_angle_to_x(context.view, angle2);
 
         // Does not cross a pixel?
         if (x1 == x2) return;
@@ -701,6 +652,9 @@ namespace rndr
 
     void bsp_renderer::impl::render_bsp_node(const context_t& context, const int node_num)
     {
+        // nothing behind the columns that are already drawn can be seen
+        if (solid_segs.is_full()) return;
+
         const auto num = static_cast<unsigned short>(node_num);
         if ((num & core::node_flags::sub_sector) != 0)
         {
@@ -716,30 +670,37 @@ namespace rndr
         render_bsp_node(context, bsp_node.children[static_cast<int>(side)].index);
 
         const auto other_side_child = bsp_node.children[static_cast<int>(side) ^ 1];
-        if (check_bounding_box(context.view.width, context.view.clip_angle, context.frame, solid_segs,
-                               other_side_child.bbox))
+        if (check_bounding_box(context.view, context.frame, solid_segs, other_side_child.bbox))
             render_bsp_node(context, other_side_child.index);
     }
 
-    void bsp_renderer::impl::reset(const int view_width, const int view_height)
+    void bsp_renderer::impl::reset(const clip_range_t& columns, const int view_height,
+                                   draw_commands& frame_commands)
     {
         std::ranges::fill(floor_clip, view_height);
         std::ranges::fill(ceiling_clip, -1);
 
-        solid_segs.reset(view_width);
+        solid_segs.reset(columns);
         draw_segs.clear();
 
         visplanes_.clear();
         last_opening_index = 0;
+
+        commands = &frame_commands;
     }
 
     bsp_renderer::bsp_renderer() : impl_(std::make_unique<impl>()) {}
 
     bsp_renderer::~bsp_renderer() = default;
 
-    void bsp_renderer::render_bsp_node(const context_t& context, const int node_num)
+    bsp_renderer::bsp_renderer(bsp_renderer&&) noexcept = default;
+
+    bsp_renderer& bsp_renderer::operator=(bsp_renderer&&) noexcept = default;
+
+    void bsp_renderer::render_bsp_node(const context_t& context, const int node_num, const clip_range_t& columns,
+                                       draw_commands& commands)
     {
-        impl_->reset(context.view.width, context.view.height);
+        impl_->reset(columns, context.view.height, commands);
         impl_->render_bsp_node(context, node_num);
         impl_->draw_visplanes(context);
     }
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <core/units.hpp>
-#include <rndr/clip_range_array.hpp>
+#include <rndr/clip_range.hpp>
 #include <rndr/context.hpp>
 
 #include <memory>
@@ -14,6 +14,8 @@ namespace game
 
 namespace rndr
 {
+    struct draw_commands;
+
     enum class silhouette_pos
     {
         none,
@@ -53,7 +55,13 @@ namespace rndr
         bsp_renderer();
         ~bsp_renderer();
 
-        void render_bsp_node(const context_t& context, const int node_num);
+        bsp_renderer(bsp_renderer&&) noexcept;
+        bsp_renderer& operator=(bsp_renderer&&) noexcept;
+
+        // Appends the draw commands for the given columns of the view. Renderers that render different
+        // columns don't share any state and can render at the same time.
+        void render_bsp_node(const context_t& context, const int node_num, const clip_range_t& columns,
+                             draw_commands& commands);
         void on_view_size_changed(const int view_width, const int view_height);
 
     private:
@@ -0,0 +1,11 @@
+#pragma once
+
+namespace rndr
+{
+    // The columns from first up to and including last
+    struct clip_range_t
+    {
+        int first = 0;
+        int last = 0;
+    };
+}
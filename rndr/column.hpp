@@ -1,7 +1,7 @@
 #pragma once
 
-#include <core/units.hpp>
 #include <rndr/lighting_tables.hpp>
+#include <rndr/number.hpp>
 
 #include <cstdint>
 #include <span>
@@ -9,6 +9,7 @@
 namespace rndr
 {
     struct context_t;
+    struct draw_commands;
     struct view_t;
 
     struct draw_column_t
@@ -17,11 +18,14 @@ namespace rndr
         int y_start = 0;
         int y_end = 0;
         std::span<const light_table_t> color_map;
-        real fraction_step{};
-        real texture_mid{};
+        number fraction_step{};
+        number texture_mid{};
         std::span<const std::uint8_t> source;
     };
 
+    // Needs the columns of the texture, which are built once per seg or plane with ensure_columns
     std::span<const std::uint8_t> get_column(const context_t& context, const int tex, const unsigned int column);
-    void draw_column(const view_t& view, const draw_column_t& dc);
+
+    // Leaves the column to the rasterizer
+    void add_column_command(const context_t& context, const draw_column_t& dc, draw_commands& commands);
 }
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <core/thread_pool.hpp>
+#include <rndr/clip_range.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace rndr
+{
+    // How many shares to split work into for the pool and the calling thread. More shares than threads evens
+    // out shares that take longer than others.
+    [[nodiscard]] inline size_t num_shares_for(const core::thread_pool& pool) { return (pool.size() + 1) * 2; }
+
+    // Splits width columns into at most num_ranges ranges of about the same width. A range is only narrower
+    // than 16 columns if all columns are.
+    [[nodiscard]] inline std::vector<clip_range_t> split_into_column_ranges(const int width, const size_t num_ranges)
+    {
+        constexpr auto min_width = 16;
+        const auto n = std::clamp(static_cast<int>(num_ranges), 1, std::max(width / min_width, 1));
+
+        auto result = std::vector<clip_range_t>(static_cast<size_t>(n));
+        for (auto i = 0; i < n; ++i)
+            result[i] = {.first = width * i / n, .last = (width * (i + 1) / n) - 1};
+
+        return result;
+    }
+}
@@ -8,6 +8,7 @@
 namespace core
 {
     struct game_data;
+    class thread_pool;
 }
 
 namespace game
@@ -24,6 +25,8 @@ namespace rndr
     struct context_t
     {
         core::game_data& data;
+        core::thread_pool& pool;
+        size_t num_shares = 1;  // how many shares work on the view may be split into, 1 when drawing in strips
         const frame_t& frame;
         const game::level_t& level;
         texture_info_t& texture_info;
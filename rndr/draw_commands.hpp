@@ -0,0 +1,70 @@
+#pragma once
+
+#include <rndr/lighting_tables.hpp>
+#include <rndr/number.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace rndr
+{
+    // A wall or sky column from y_start down to y_end
+    struct column_command
+    {
+        int x = 0;
+        int y_start = 0;
+        int y_end = 0;
+        number fraction{};  // the texture row at y_start
+        number fraction_step{};
+        std::span<const std::uint8_t> source;
+        std::span<const light_table_t> color_map;
+    };
+
+    // A floor or ceiling span from x_start up to (but not including) x_end
+    struct span_command
+    {
+        int y = 0;
+        int x_start = 0;
+        int x_end = 0;
+        int center_x = 0;
+        // the texture coordinates in the center column of the view
+        number u_center{};
+        number v_center{};
+        number u_step{};
+        number v_step{};
+        std::span<const std::uint8_t> source;
+        std::span<const light_table_t> color_map;
+    };
+
+    // What the BSP traversal of a frame leaves for the rasterizer. No two commands draw the same pixel, so
+    // they can be drawn in any order. The sources point into the column store and the lump cache, so the
+    // cache mustn't release evicted lumps before the commands are rasterized.
+    struct draw_commands
+    {
+        std::vector<column_command> columns;
+        std::vector<span_command> spans;
+
+        void clear()
+        {
+            columns.clear();
+            spans.clear();
+        }
+
+        void append(const draw_commands& other)
+        {
+            columns.insert(columns.end(), other.columns.begin(), other.columns.end());
+            spans.insert(spans.end(), other.spans.begin(), other.spans.end());
+        }
+
+        // Commands that read from the same texture end up next to each other. The commands can be drawn in any
+        // order, so the sort doesn't have to be stable (and doesn't allocate).
+        void sort_by_texture()
+        {
+            const auto source = [](const auto& command) { return command.source.data(); };
+            std::ranges::sort(columns, {}, source);
+            std::ranges::sort(spans, {}, source);
+        }
+    };
+}
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <core/radians.hpp>
+#include <core/bam.hpp>
 #include <core/vec.hpp>
 
 namespace rndr
@@ -9,7 +9,7 @@ namespace rndr
     {
         core::pos position;
         core::units z;
-        core::radians angle;
+        core::bam angle;
         int extra_light = 0;
     };
 }
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include <rndr/framebuffer.hpp>
+
+#include <fmt/format.h>
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace rndr
+{
+    namespace
+    {
+        constexpr auto block_size = 16;
+
+#if defined(__SSE2__)
+        // (__m128i carries attributes that get lost in templates like std::array, hence the plain arrays)
+        template <size_t UnitBytes>
+        void unpack(__m128i& a, __m128i& b)
+        {
+            const auto low = a;
+            if constexpr (UnitBytes == 1)
+            {
+                a = _mm_unpacklo_epi8(low, b);
+                b = _mm_unpackhi_epi8(low, b);
+            }
+            else if constexpr (UnitBytes == 2)
+            {
+                a = _mm_unpacklo_epi16(low, b);
+                b = _mm_unpackhi_epi16(low, b);
+            }
+            else if constexpr (UnitBytes == 4)
+            {
+                a = _mm_unpacklo_epi32(low, b);
+                b = _mm_unpackhi_epi32(low, b);
+            }
+            else
+            {
+                a = _mm_unpacklo_epi64(low, b);
+                b = _mm_unpackhi_epi64(low, b);
+            }
+        }
+
+        template <size_t UnitBytes>
+        void interleave(__m128i (&r)[block_size], const size_t bit)
+        {
+            for (size_t i = 0; i < block_size; ++i)
+            {
+                if ((i & bit) == 0) unpack<UnitBytes>(r[i], r[i | bit]);
+            }
+        }
+
+        // Four rounds of interleaving pairs of registers, with 8, 16, 32 and 64 bit units. Round k pairs the
+        // registers whose numbers differ in bit k, which leaves column c of the block in the register whose
+        // number is c with its four bits reversed.
+        void transpose_block(const grfx::pixel_t* source, const size_t source_pitch, grfx::pixel_t* target,
+                             const size_t target_pitch)
+        {
+            __m128i r[block_size];
+            for (size_t i = 0; i < block_size; ++i)
+                r[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * source_pitch));
+
+            interleave<1>(r, 1);
+            interleave<2>(r, 2);
+            interleave<4>(r, 4);
+            interleave<8>(r, 8);
+
+            constexpr auto bit_reversed = std::array<size_t, block_size>{0, 8, 4, 12, 2, 10, 6, 14,
+                                                                         1, 9, 5, 13, 3, 11, 7, 15};
+            for (size_t i = 0; i < block_size; ++i)
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(target + bit_reversed[i] * target_pitch), r[i]);
+        }
+#else
+        void transpose_block(const grfx::pixel_t* source, const size_t source_pitch, grfx::pixel_t* target,
+                             const size_t target_pitch)
+        {
+            for (size_t x = 0; x < block_size; ++x)
+            {
+                for (size_t y = 0; y < block_size; ++y)
+                    target[y * target_pitch + x] = source[x * source_pitch + y];
+            }
+        }
+#endif
+    }
+
+    void transpose(const framebuffer_view& source, const framebuffer_view& target)
+    {
+        if ((source.layout != framebuffer_layout::column_major) || (target.layout != framebuffer_layout::row_major) ||
+            (source.width != target.width) || (source.height != target.height))
+        {
+            throw std::invalid_argument(fmt::format("Can't transpose a {}x{} framebuffer into a {}x{} one",
+                                                    source.width, source.height, target.width, target.height));
+        }
+
+        const auto source_pitch = static_cast<size_t>(source.pitch);
+        const auto target_pitch = static_cast<size_t>(target.pitch);
+        const auto pixel = [](const framebuffer_view& view, const size_t line, const size_t offset) {
+            return view.pixels.subspan(line * static_cast<size_t>(view.pitch) + offset).data();
+        };
+
+        const auto whole_width = source.width - (source.width % block_size);
+        const auto whole_height = source.height - (source.height % block_size);
+        for (auto x = 0; x < whole_width; x += block_size)
+        {
+            for (auto y = 0; y < whole_height; y += block_size)
+            {
+                const auto* block = pixel(source, static_cast<size_t>(x), static_cast<size_t>(y));
+                transpose_block(block, source_pitch, pixel(target, static_cast<size_t>(y), static_cast<size_t>(x)),
+                                target_pitch);
+            }
+        }
+
+        // what is left at the right and bottom edges doesn't fill whole blocks
+        for (auto x = 0; x < source.width; ++x)
+        {
+            const auto column = source.column(x);
+            for (auto y = (x < whole_width) ? whole_height : 0; y < source.height; ++y)
+                target.pixels[static_cast<size_t>(y) * target_pitch + static_cast<size_t>(x)] = column[y];
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <grfx/grfx.hpp>
+
+#include <span>
+#include <vector>
+
+namespace rndr
+{
+    // Row major framebuffers are what gets presented. Column major ones keep the pixels of a column next to
+    // each other, which suits walls and the sky, and have to be transposed before they can be presented.
+    enum class framebuffer_layout
+    {
+        row_major,
+        column_major
+    };
+
+    // The pixels the renderer draws a frame into. Rows (or columns, in a column major framebuffer) are pitch
+    // pixels apart, which lets the view be a part of a wider screen.
+    struct framebuffer_view
+    {
+        std::span<grfx::pixel_t> pixels;
+        int width = 0;
+        int height = 0;
+        int pitch = 0;
+        framebuffer_layout layout = framebuffer_layout::row_major;
+
+        // Only for row major framebuffers
+        [[nodiscard]] std::span<grfx::pixel_t> row(const int y) const
+        {
+            return pixels.subspan(static_cast<size_t>(y) * static_cast<size_t>(pitch), static_cast<size_t>(width));
+        }
+
+        // Only for column major framebuffers
+        [[nodiscard]] std::span<grfx::pixel_t> column(const int x) const
+        {
+            return pixels.subspan(static_cast<size_t>(x) * static_cast<size_t>(pitch), static_cast<size_t>(height));
+        }
+
+        // The number of pixels from the first one to the last one
+        [[nodiscard]] size_t extent() const
+        {
+            const auto lines = (layout == framebuffer_layout::row_major) ? height : width;
+            const auto line_size = (layout == framebuffer_layout::row_major) ? width : height;
+            return (lines > 0) ? static_cast<size_t>(lines - 1) * static_cast<size_t>(pitch) + line_size : 0;
+        }
+    };
+
+    // A framebuffer that owns its pixels, for rendering without a window or for rendering column major
+    class framebuffer
+    {
+    public:
+        framebuffer(const int width, const int height, const framebuffer_layout layout = framebuffer_layout::row_major)
+            : pixels_(static_cast<size_t>(width) * static_cast<size_t>(height)),
+              width_(width),
+              height_(height),
+              layout_(layout)
+        {
+        }
+
+        [[nodiscard]] framebuffer_view view()
+        {
+            const auto pitch = (layout_ == framebuffer_layout::row_major) ? width_ : height_;
+            return {.pixels = pixels_, .width = width_, .height = height_, .pitch = pitch, .layout = layout_};
+        }
+
+        [[nodiscard]] std::span<const grfx::pixel_t> pixels() const { return pixels_; }
+        [[nodiscard]] int width() const { return width_; }
+        [[nodiscard]] int height() const { return height_; }
+        [[nodiscard]] framebuffer_layout layout() const { return layout_; }
+
+    private:
+        std::vector<grfx::pixel_t> pixels_;
+        int width_ = 0;
+        int height_ = 0;
+        framebuffer_layout layout_ = framebuffer_layout::row_major;
+    };
+
+    // Copies a column major framebuffer into a row major one of the same size, 16x16 blocks at a time
+    void transpose(const framebuffer_view& source, const framebuffer_view& target);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <core/fixed.hpp>
+#include <core/units.hpp>
+
+#include <string_view>
+
+namespace rndr
+{
+    // The numbers the inner loops of the renderer step with: walls down the screen, columns down their
+    // texture and spans across their flat. They get picked when the engine is configured, see RENDER_NUMBER
+    // in CMakeLists.txt, so every variant can be timed with the same timedemo.
+#if defined(RNDR_NUMBER_FIXED)
+    using number = core::fixed;
+    constexpr auto number_name = std::string_view("fixed");
+#elif defined(RNDR_NUMBER_DOUBLE)
+    using number = double;
+    constexpr auto number_name = std::string_view("double");
+#else
+    using number = float;
+    constexpr auto number_name = std::string_view("float");
+#endif
+
+    constexpr number to_number(const core::units x) { return static_cast<number>(static_cast<real>(x)); }
+}
@@ -0,0 +1,308 @@
+#include <rndr/rasterizer.hpp>
+
+#include <core/thread_pool.hpp>
+#include <rndr/column_ranges.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <concepts>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace rndr
+{
+    namespace
+    {
+        constexpr bool is_power_of_two(const std::integral auto i) { return (i & (i - 1)) == 0; }
+
+        constexpr auto row_major = framebuffer_layout::row_major;
+
+        template <framebuffer_layout Layout>
+        size_t pixel_index(const framebuffer_view& target, const int x, const int y)
+        {
+            const auto pitch = static_cast<size_t>(target.pitch);
+            if constexpr (Layout == row_major)
+                return static_cast<size_t>(y) * pitch + static_cast<size_t>(x);
+            else
+                return static_cast<size_t>(x) * pitch + static_cast<size_t>(y);
+        }
+
+        // how many pixels apart the pixels of a column are
+        template <framebuffer_layout Layout>
+        size_t column_stride(const framebuffer_view& target)
+        {
+            return (Layout == row_major) ? static_cast<size_t>(target.pitch) : 1;
+        }
+
+        // how many pixels apart the pixels of a row are
+        template <framebuffer_layout Layout>
+        size_t row_stride(const framebuffer_view& target)
+        {
+            return (Layout == row_major) ? 1 : static_cast<size_t>(target.pitch);
+        }
+
+        template <framebuffer_layout Layout, bool IsSourceSizePowerOf2>
+        void blit_source_column_to_dest(const size_t count, const int mask, const framebuffer_view& target,
+                                        const column_command& dc)
+        {
+            const auto w = column_stride<Layout>(target);
+            const auto dest_span =
+                target.pixels.subspan(pixel_index<Layout>(target, dc.x, dc.y_start), w * (count - 1) + 1);
+            auto fraction = dc.fraction;
+            const auto source_size = static_cast<number>(dc.source.size());
+            for (size_t i = 0; i < count; ++i)
+            {
+                const auto source_index = static_cast<int>(fraction) & mask;
+                const auto source = dc.source[source_index];
+                dest_span[i * w] = dc.color_map[source];
+                fraction += dc.fraction_step;
+
+                if constexpr (IsSourceSizePowerOf2)
+                {
+                    if (fraction >= source_size) fraction -= source_size;
+                }
+            }
+        }
+
+        template <framebuffer_layout Layout>
+        void draw_column(const framebuffer_view& target, const column_command& dc)
+        {
+            const auto count = static_cast<size_t>((dc.y_end - dc.y_start) + 1);
+            if (is_power_of_two(dc.source.size()))
+                blit_source_column_to_dest<Layout, true>(count, dc.source.size() - 1, target, dc);
+            else
+                blit_source_column_to_dest<Layout, false>(count, 0xffffffff, target, dc);
+        }
+
+        template <typename Number>
+        auto source_pixel(const Number u, const Number v, const std::span<const std::uint8_t> source)
+        {
+            // fixed point numbers shift v into place, multiplying would overflow far from the origin of the map
+            const auto row = [&] {
+                if constexpr (std::same_as<Number, core::fixed>)
+                    return (v.raw_value() >> (core::fixed::fraction_bits - 6)) & (63 * 64);
+                else
+                    return static_cast<int>(v * Number{64}) & (63 * 64);
+            }();
+            const auto index = row + (static_cast<int>(u) & 63);
+            return source[index];
+        }
+
+        template <framebuffer_layout Layout>
+        void draw_span_scalar(const framebuffer_view& target, const span_command& ds, const int x_start,
+                              const int x_end)
+        {
+            const auto count = static_cast<size_t>(x_end - x_start);
+            const auto w = row_stride<Layout>(target);
+            const auto dest_span =
+                target.pixels.subspan(pixel_index<Layout>(target, x_start, ds.y), w * (count - 1) + 1);
+
+            // the texture coordinates of a pixel only depend on its column, not on where its span starts
+            auto dx = static_cast<number>(x_start - ds.center_x);
+            for (size_t i = 0; i < count; ++i)
+            {
+                const auto u = ds.u_center + dx * ds.u_step;
+                const auto v = ds.v_center + dx * ds.v_step;
+                dest_span[i * w] = ds.color_map[source_pixel(u, v, ds.source)];
+
+                dx += number{1};
+            }
+        }
+
+#if defined(__x86_64__) || defined(__i386__)
+        // The byte at every index, gathered as the 32 bit words that hold them. The words are aligned to
+        // their offset from base, so nothing past the word holding the last byte gets read.
+        __attribute__((target("avx2"))) __m256i gather_bytes(const std::uint8_t* base, const __m256i index)
+        {
+            const auto words = _mm256_i32gather_epi32(reinterpret_cast<const int*>(base),
+                                                      _mm256_and_si256(index, _mm256_set1_epi32(~3)), 1);
+            const auto shift = _mm256_slli_epi32(_mm256_and_si256(index, _mm256_set1_epi32(3)), 3);
+            return _mm256_and_si256(_mm256_srlv_epi32(words, shift), _mm256_set1_epi32(0xff));
+        }
+
+        // The arithmetic of draw_span_scalar eight pixels at a time, which gives the same pixels
+        template <framebuffer_layout Layout>
+        __attribute__((target("avx2"))) void draw_span_avx2(const framebuffer_view& target, const span_command& ds,
+                                                            const int x_start, const int x_end)
+        {
+            constexpr auto lanes = 8;
+            const auto count = static_cast<size_t>(x_end - x_start);
+            const auto w = row_stride<Layout>(target);
+            const auto dest_span =
+                target.pixels.subspan(pixel_index<Layout>(target, x_start, ds.y), w * (count - 1) + 1);
+
+            const auto u_center = _mm256_set1_ps(static_cast<real>(ds.u_center));
+            const auto v_center = _mm256_set1_ps(static_cast<real>(ds.v_center));
+            const auto u_step = _mm256_set1_ps(static_cast<real>(ds.u_step));
+            const auto v_step = _mm256_set1_ps(static_cast<real>(ds.v_step));
+            auto dx = _mm256_add_ps(_mm256_set1_ps(static_cast<real>(x_start - ds.center_x)),
+                                    _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+
+            size_t i = 0;
+            for (; i + lanes <= count; i += lanes)
+            {
+                const auto u = _mm256_add_ps(u_center, _mm256_mul_ps(dx, u_step));
+                const auto v = _mm256_add_ps(v_center, _mm256_mul_ps(dx, v_step));
+                const auto row = _mm256_and_si256(_mm256_cvttps_epi32(_mm256_mul_ps(v, _mm256_set1_ps(64))),
+                                                  _mm256_set1_epi32(63 * 64));
+                const auto column = _mm256_and_si256(_mm256_cvttps_epi32(u), _mm256_set1_epi32(63));
+                const auto texels = gather_bytes(ds.source.data(), _mm256_add_epi32(row, column));
+                const auto pixels = gather_bytes(ds.color_map.data(), texels);
+
+                if constexpr (Layout == row_major)
+                {
+                    // the low byte of every lane, the first four pixels in the low half and the others in the high
+                    const auto packed = _mm256_packus_epi16(_mm256_packus_epi32(pixels, pixels), pixels);
+                    const auto first = _mm_cvtsi128_si32(_mm256_castsi256_si128(packed));
+                    const auto second = _mm_cvtsi128_si32(_mm256_extracti128_si256(packed, 1));
+                    std::memcpy(&dest_span[i], &first, sizeof(first));
+                    std::memcpy(&dest_span[i + 4], &second, sizeof(second));
+                }
+                else
+                {
+                    alignas(32) auto values = std::array<std::int32_t, lanes>();
+                    _mm256_store_si256(reinterpret_cast<__m256i*>(values.data()), pixels);
+                    for (size_t lane = 0; lane < lanes; ++lane)
+                        dest_span[(i + lane) * w] = static_cast<grfx::pixel_t>(values[lane]);
+                }
+
+                dx = _mm256_add_ps(dx, _mm256_set1_ps(lanes));
+            }
+
+            if (i < count) draw_span_scalar<Layout>(target, ds, x_start + static_cast<int>(i), x_end);
+        }
+
+        span_drawer detect_span_drawer()
+        {
+            // the AVX2 drawer steps in floats
+            if (!std::same_as<number, float>) return span_drawer::scalar;
+
+            return __builtin_cpu_supports("avx2") ? span_drawer::avx2 : span_drawer::scalar;
+        }
+#else
+        span_drawer detect_span_drawer() { return span_drawer::scalar; }
+#endif
+
+        std::atomic<span_drawer> active_span_drawer{best_span_drawer()};
+
+        template <framebuffer_layout Layout>
+        void draw_span(const framebuffer_view& target, const span_command& ds, const int x_start, const int x_end)
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            if (active_span_drawer.load(std::memory_order_relaxed) == span_drawer::avx2)
+            {
+                draw_span_avx2<Layout>(target, ds, x_start, x_end);
+                return;
+            }
+#endif
+            draw_span_scalar<Layout>(target, ds, x_start, x_end);
+        }
+
+        // The commands that touch each band, as indices of the commands. Within a band they keep their order.
+        struct band_index
+        {
+            std::vector<size_t> offsets;  // the commands of band i are order[offsets[i]] up to order[offsets[i + 1]]
+            std::vector<size_t> order;
+
+            [[nodiscard]] std::span<const size_t> band(const size_t i) const
+            {
+                return std::span(order).subspan(offsets[i], offsets[i + 1] - offsets[i]);
+            }
+        };
+
+        // The band that column x falls into
+        size_t band_of(const std::vector<clip_range_t>& bands, const int x)
+        {
+            const auto it = std::ranges::upper_bound(bands, x, {}, &clip_range_t::first);
+            return (it == bands.begin()) ? 0 : static_cast<size_t>(it - bands.begin() - 1);
+        }
+
+        // Buckets the commands by the bands they touch with a counting sort, so every band only looks at its
+        // own commands instead of all of them. first_last returns the first and the last column of a command.
+        template <typename Command, typename FirstLast>
+        band_index index_by_band(const std::vector<Command>& commands, const std::vector<clip_range_t>& bands,
+                                 FirstLast&& first_last)
+        {
+            const auto band_range = [&](const Command& command) {
+                const auto [first, last] = first_last(command);
+                return std::pair(band_of(bands, first), (first <= last) ? band_of(bands, last) + 1 : 0);
+            };
+
+            auto result = band_index{.offsets = std::vector<size_t>(bands.size() + 1), .order = {}};
+            for (const auto& command : commands)
+            {
+                const auto [begin, end] = band_range(command);
+                for (auto b = begin; b < end; ++b)
+                    ++result.offsets[b + 1];
+            }
+
+            for (size_t b = 1; b < result.offsets.size(); ++b)
+                result.offsets[b] += result.offsets[b - 1];
+
+            result.order.resize(result.offsets.back());
+            auto next = std::vector<size_t>(result.offsets.begin(), result.offsets.end() - 1);
+            for (size_t i = 0; i < commands.size(); ++i)
+            {
+                const auto [begin, end] = band_range(commands[i]);
+                for (auto b = begin; b < end; ++b)
+                    result.order[next[b]++] = i;
+            }
+
+            return result;
+        }
+
+        template <framebuffer_layout Layout>
+        void rasterize_band(const draw_commands& commands, const band_index& columns, const band_index& spans,
+                            const framebuffer_view& target, const size_t i, const clip_range_t& band)
+        {
+            for (const auto c : columns.band(i))
+                draw_column<Layout>(target, commands.columns[c]);
+
+            for (const auto s : spans.band(i))
+            {
+                const auto& span = commands.spans[s];
+                const auto x_start = std::max(span.x_start, band.first);
+                const auto x_end = std::min(span.x_end, band.last + 1);
+                if (x_start < x_end) draw_span<Layout>(target, span, x_start, x_end);
+            }
+        }
+    }
+
+    span_drawer best_span_drawer()
+    {
+        static const auto best = detect_span_drawer();
+        return best;
+    }
+
+    void use_span_drawer(const span_drawer drawer)
+    {
+        if ((drawer == span_drawer::avx2) && (best_span_drawer() != span_drawer::avx2))
+            throw std::invalid_argument("The AVX2 span drawer needs an AVX2 CPU and a renderer built with floats");
+
+        active_span_drawer.store(drawer, std::memory_order_relaxed);
+    }
+
+    void rasterize(const draw_commands& commands, const framebuffer_view& target, core::thread_pool& pool)
+    {
+        const auto bands = split_into_column_ranges(target.width, num_shares_for(pool));
+        const auto columns =
+            index_by_band(commands.columns, bands, [](const column_command& c) { return std::pair(c.x, c.x); });
+        const auto spans = index_by_band(commands.spans, bands,
+                                         [](const span_command& s) { return std::pair(s.x_start, s.x_end - 1); });
+
+        pool.parallel_for(bands.size(), [&](const size_t i) {
+            if (target.layout == row_major)
+                rasterize_band<framebuffer_layout::row_major>(commands, columns, spans, target, i, bands[i]);
+            else
+                rasterize_band<framebuffer_layout::column_major>(commands, columns, spans, target, i, bands[i]);
+        });
+    }
+}
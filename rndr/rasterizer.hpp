@@ -0,0 +1,32 @@
+#pragma once
+
+#include <rndr/draw_commands.hpp>
+#include <rndr/framebuffer.hpp>
+
+namespace core
+{
+    class thread_pool;
+}
+
+namespace rndr
+{
+    // The ways the rasterizer can draw floor and ceiling spans. They draw exactly the same pixels, the AVX2
+    // one works out eight of them at a time.
+    enum class span_drawer
+    {
+        scalar,
+        avx2
+    };
+
+    // The fastest span drawer this CPU can run, which is also the one the rasterizer starts out with. The AVX2
+    // one steps in floats, so it's only ever picked when the renderer is built with floats.
+    [[nodiscard]] span_drawer best_span_drawer();
+
+    // Throws if the span drawer can't run here
+    void use_span_drawer(const span_drawer drawer);
+
+    // Draws the commands into the target on the thread pool. The target is split into bands of columns and
+    // every band is drawn by a single thread, spans that cross bands are cut at the band edges. The target
+    // can have either layout.
+    void rasterize(const draw_commands& commands, const framebuffer_view& target, core::thread_pool& pool);
+}
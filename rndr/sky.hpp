@@ -4,6 +4,7 @@
 
 namespace rndr
 {
-    constexpr auto sky_column_factor = real{1024};
+    // the sky is 1024 columns around, which is four times its texture
+    constexpr auto angle_to_sky_shift = 22;
     constexpr auto sky_texture_mid = real{100};
 }
\ No newline at end of file
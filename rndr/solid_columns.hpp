@@ -0,0 +1,108 @@
+#pragma once
+
+#include <grfx/screen_size.hpp>
+#include <rndr/clip_range.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+
+namespace rndr
+{
+    // The columns of the view that solid walls already cover, one bit per column. Queries and updates work on
+    // whole words of columns, so none of them takes more than max_screen_width / 64 steps, however the solid
+    // columns are scattered. Columns outside the view count as solid.
+    class solid_columns
+    {
+        using word_t = std::uint64_t;
+        static constexpr int word_bits = std::numeric_limits<word_t>::digits;
+        static constexpr int num_columns = grfx::max_screen_width;
+
+        std::array<word_t, (num_columns + word_bits - 1) / word_bits> words_{};
+        int num_open_ = 0;
+
+        // Calls func with the index of every word that holds one of the columns from first to last (which have
+        // to be in the view) and the mask of those columns in it, until func returns false
+        template <typename Func>
+        static constexpr void for_each_word(const int first, const int last, Func&& func)
+        {
+            if (first > last) return;
+
+            for (auto w = first / word_bits; w <= last / word_bits; ++w)
+            {
+                const auto low = std::max(first - (w * word_bits), 0);
+                const auto high = std::min(last - (w * word_bits), word_bits - 1);
+                const auto mask = (~word_t{0} >> (word_bits - 1 - high)) & (~word_t{0} << low);
+                if (!func(static_cast<size_t>(w), mask)) return;
+            }
+        }
+
+    public:
+        constexpr void reset(const int view_width) { reset({.first = 0, .last = view_width - 1}); }
+
+        // Only the given columns are open, everything left and right of them counts as solid
+        constexpr void reset(const clip_range_t& columns)
+        {
+            words_.fill(~word_t{0});
+            num_open_ = 0;
+
+            for_each_word(std::max(columns.first, 0), std::min(columns.last, num_columns - 1),
+                          [&](const size_t w, const word_t mask) {
+                              words_[w] &= ~mask;
+                              num_open_ += std::popcount(mask);
+                              return true;
+                          });
+        }
+
+        // Marks the columns from first to last as solid
+        constexpr void insert(const int first, const int last)
+        {
+            for_each_word(std::max(first, 0), std::min(last, num_columns - 1), [&](const size_t w, const word_t mask) {
+                num_open_ -= std::popcount(mask & ~words_[w]);
+                words_[w] |= mask;
+                return true;
+            });
+        }
+
+        // The first open column from first to last, last + 1 if they are all solid
+        [[nodiscard]] constexpr int first_open(const int first, const int last) const
+        {
+            auto result = last + 1;
+            for_each_word(std::max(first, 0), std::min(last, num_columns - 1), [&](const size_t w, const word_t mask) {
+                const auto open = mask & ~words_[w];
+                if (open != 0) result = (static_cast<int>(w) * word_bits) + std::countr_zero(open);
+
+                return open == 0;
+            });
+
+            return result;
+        }
+
+        // The first solid column from first to last, last + 1 if they are all open
+        [[nodiscard]] constexpr int first_solid(const int first, const int last) const
+        {
+            if ((first < 0) || (first >= num_columns)) return std::min(first, last + 1);
+
+            auto result = (last < num_columns) ? last + 1 : num_columns;
+            for_each_word(first, std::min(last, num_columns - 1), [&](const size_t w, const word_t mask) {
+                const auto solid = mask & words_[w];
+                if (solid != 0) result = (static_cast<int>(w) * word_bits) + std::countr_zero(solid);
+
+                return solid == 0;
+            });
+
+            return result;
+        }
+
+        // Whether all the columns from first to last are solid
+        [[nodiscard]] constexpr bool is_covered(const int first, const int last) const
+        {
+            return first_open(first, last) > last;
+        }
+
+        // Whether every column of the view is solid, nothing behind them can be seen any more
+        [[nodiscard]] constexpr bool is_full() const { return num_open_ == 0; }
+    };
+}
@@ -1,18 +1,24 @@
 #include <rndr/system.hpp>
 
+#include <core/thread_pool.hpp>
 #include <core/wad_types.hpp>
 #include <game/level.hpp>
 #include <game/mobj.hpp>
 #include <grfx/system.hpp>
 #include <rndr/bsp_renderer.hpp>
+#include <rndr/column_ranges.hpp>
 #include <rndr/context.hpp>
+#include <rndr/draw_commands.hpp>
 #include <rndr/frame.hpp>
+#include <rndr/rasterizer.hpp>
 #include <rndr/texture_info.hpp>
+#include <rndr/trigonometry.hpp>
 #include <rndr/view.hpp>
 #include <stdx/to.hpp>
 
 #include <algorithm>
 #include <span>
+#include <vector>
 
 namespace rndr
 {
@@ -26,8 +32,9 @@ namespace rndr
 
         short patch_num_from_name_array(core::game_data& data, const std::array<char, 8>& name_array)
         {
-            const auto it = data.lump_table.find(core::array_to_string(name_array));
-            return static_cast<short>((it != data.lump_table.end()) ? it->second : -1);
+            // PWADs often ship patches without P_START / P_END markers, so look in the global namespace
+            const auto num = core::find_lump_num(data, core::lump_key(name_array));
+            return static_cast<short>(num ? static_cast<int>(*num) : -1);
         }
 
         auto load_patches(const std::vector<short>& patch_nums, const core::map_texture& tex)
@@ -48,65 +55,13 @@ namespace rndr
             return result;
         }
 
-        void generate_lookup(core::game_data& data, const int tex_num, texture_info_t& info)
+        auto offset_to_texture(const core::lump_byte_stream& stream, const std::vector<short>& patch_nums)
         {
-            const auto& texture = info.textures[tex_num];
-
-            // Composited texture not created yet.
-            info.composite_size[tex_num] = 0;
-            auto& col_lump = info.column_lump[tex_num];
-            col_lump.resize(texture.width, 0);
-            auto& col_offset = info.column_offset[tex_num];
-            col_offset.resize(texture.width, 0);
-
-            // Now count the number of columns
-            //  that are covered by more than one patch.
-            // Fill in the lump / offset, so columns
-            //  with only a single patch are all done.
-            auto patch_count = std::vector<std::uint8_t>(texture.width, 0);
-
-            for (const auto& patch : texture.patches)
-            {
-                const auto& real_patch = *core::cache_lump_num<grfx::patch_t>(data, patch.patch);
-                const auto col_offsets = std::span(&real_patch.first_column_offset, real_patch.width);
-                const auto x1 = patch.origin_x;
-                const auto x2 = std::min(static_cast<short>(x1 + real_patch.width), texture.width);
-
-                for (auto x = std::max(short(0), x1); x < x2; ++x)
-                {
-                    patch_count[x]++;
-                    col_lump[x] = patch.patch;
-                    col_offset[x] = col_offsets[x - x1] + 3;
-                }
-            }
-
-            for (auto x = 0; x < texture.width; x++)
-            {
-                if (patch_count[x] == 0)
-                {
-                    fmt::print("generate_lookup: column without a patch ({})\n", texture.name);
-                    return;
-                }
-
-                if (patch_count[x] > 1)
-                {
-                    // Use the cached block.
-                    col_lump[x] = -1;
-                    col_offset[x] = info.composite_size[tex_num];
-
-                    if (info.composite_size[tex_num] > 0x10000 - texture.height)
-                        throw std::runtime_error(fmt::format("generate_lookup: texture {} is >64k", tex_num));
-
-                    info.composite_size[tex_num] += texture.height;
-                }
-            }
-        }
-
-        auto offset_to_texture(core::lump_byte_stream& stream, const std::vector<short>& patch_nums)
-        {
-            return [&](const std::uint32_t offset) {
-                stream.set_pos(offset);
-                const auto& t = stream.read_span<core::map_texture>(1)[0];
+            // each texture reads from its own copy of the stream, so textures can be loaded concurrently
+            return [&stream, &patch_nums](const std::uint32_t offset) {
+                auto texture_stream = stream;
+                texture_stream.set_pos(offset);
+                const auto& t = texture_stream.read_span<core::map_texture>(1)[0];
                 return texture_t{.name = core::array_to_string(t.name),
                                  .width = t.width,
                                  .height = t.height,
@@ -114,21 +69,24 @@ namespace rndr
             };
         }
 
-        void load_textures(const std::vector<short>& patch_nums, core::game_data& data, const std::string_view name,
-                           std::vector<texture_t>& result)
+        void load_textures(core::thread_pool& pool, const std::vector<short>& patch_nums, core::game_data& data,
+                           const core::lump_key name, std::vector<texture_t>& result)
         {
             auto stream = core::lump_byte_stream(data, name);
             const auto num_textures = stream.read<std::uint32_t>();
             const auto num_existing = result.size();
             result.resize(num_existing + num_textures);
             const auto offsets = stream.read_span<std::uint32_t>(num_textures);
-            std::ranges::transform(offsets, std::next(result.begin(), static_cast<ptrdiff_t>(num_existing)),
-                                   offset_to_texture(stream, patch_nums));
+            const auto to_texture = offset_to_texture(stream, patch_nums);
+            pool.parallel_for(offsets.size(),
+                              [&](const size_t i) { result[num_existing + i] = to_texture(offsets[i]); });
         }
 
-        texture_info_t init_textures(core::game_data& data)
+        // Every texture is set up independently of the others and only writes to its own entries in the
+        // texture info, so the result doesn't depend on how the textures are spread over the threads.
+        texture_info_t init_textures(core::thread_pool& pool, core::game_data& data, const texture_setup setup)
         {
-            auto names_stream = core::lump_byte_stream(data, "PNAMES");
+            auto names_stream = core::lump_byte_stream(data, "PNAMES"_lump);
             const auto num_patches = names_stream.read<std::uint32_t>();
             const auto names = names_stream.read_span<std::array<char, 8>>(num_patches);
             const auto patch_nums =
@@ -136,30 +94,28 @@ namespace rndr
                 | stdx::to<std::vector>();
 
             texture_info_t result;
-            load_textures(patch_nums, data, "TEXTURE1", result.textures);
-            if (data.lump_table.contains("TEXTURE2")) load_textures(patch_nums, data, "TEXTURE2", result.textures);
-
-            result.width_mask.resize(result.textures.size());
-            std::ranges::transform(result.textures, result.width_mask.begin(), [](const texture_t& t) {
-                int j = 1;
-                while (j * 2 <= t.width)
-                    j <<= 1;
-
-                return j - 1;
-            });
+            load_textures(pool, patch_nums, data, "TEXTURE1"_lump, result.textures);
+            if (core::find_lump_num(data, "TEXTURE2"_lump))
+                load_textures(pool, patch_nums, data, "TEXTURE2"_lump, result.textures);
 
             result.height.resize(result.textures.size());
             std::ranges::transform(result.textures, result.height.begin(),
                                    [](const texture_t& t) { return core::units(t.height); });
 
-            result.composite_size.resize(result.textures.size());
-            result.column_lump.resize(result.textures.size());
-            result.column_offset.resize(result.textures.size());
-            result.composite.resize(result.textures.size());
-            result.composite_size.resize(result.textures.size());
+            result.texture_nums.reserve(result.textures.size());
+            for (size_t i = 0; i < result.textures.size(); ++i)
+            {
+                const auto name = core::lump_key(result.textures[i].name);
+                if (!result.texture_nums.contains(name)) result.texture_nums.insert_or_assign(name, i);
+            }
 
-            for (auto i = 0; i < result.textures.size(); ++i)
-                generate_lookup(data, i, result);
+            init_column_store(result);
+
+            if (setup == texture_setup::eager)
+            {
+                pool.parallel_for(result.textures.size(),
+                                  [&](const size_t i) { ensure_columns(data, static_cast<int>(i), result); });
+            }
 
             return result;
         }
@@ -169,14 +125,18 @@ namespace rndr
             const auto half_view_width = grfx::original_screen_width / 2;
             const auto focal_length = half_view_width / tan(fov * 0.5);
             const auto clip_angle = normalize(core::atan((half_view_width + 1) / focal_length));
-            return {.width = grfx::original_screen_width,
-                    .height = grfx::original_screen_height,
-                    .center_x = grfx::original_screen_width / 2,
-                    .center_y = grfx::original_screen_height / 2,
-                    .center_x_fraction = core::units(grfx::original_screen_width / 2),
-                    .center_y_fraction = core::units(grfx::original_screen_height / 2),
-                    .projection = core::units(grfx::original_screen_width / 2),
-                    .clip_angle = clip_angle};
+            auto result = view_t{.width = grfx::original_screen_width,
+                                 .height = grfx::original_screen_height,
+                                 .center_x = grfx::original_screen_width / 2,
+                                 .center_y = grfx::original_screen_height / 2,
+                                 .center_x_fraction = core::units(grfx::original_screen_width / 2),
+                                 .center_y_fraction = core::units(grfx::original_screen_height / 2),
+                                 .projection = core::units(grfx::original_screen_width / 2),
+                                 .clip_angle = core::bam(clip_angle),
+                                 .x_to_angle = {},
+                                 .angle_to_x = {}};
+            build_view_angle_tables(result);
+            return result;
         }
 
         auto color_map_start(const int level)
@@ -204,19 +164,36 @@ namespace rndr
 
     struct system::impl
     {
+        impl(core::thread_pool& thread_pool, const render_mode render_mode, const command_order command_order)
+            : pool(thread_pool), mode(render_mode), order(command_order)
+        {
+        }
+
+        core::thread_pool& pool;
+        render_mode mode;
+        command_order order;
         texture_info_t texture_info;
         std::span<const light_table_t> color_maps;
 
         bool is_view_up_to_date = false;
         view_t view;
         lighting_tables_t lighting_tables;
-        bsp_renderer renderer;
+
+        // one renderer for every strip of the view
+        std::vector<clip_range_t> strips;
+        std::vector<bsp_renderer> renderers;
+        std::vector<draw_commands> strip_commands;
+
+        // the commands of the frame that draw is drawing
+        draw_commands frame_commands;
     };
 
-    system::system(core::game_data& data) : impl_(std::make_unique<impl>())
+    system::system(core::game_data& data, core::thread_pool& pool, const texture_setup setup, const render_mode mode,
+                   const command_order order)
+        : impl_(std::make_unique<impl>(pool, mode, order))
     {
-        impl_->texture_info = init_textures(data);
-        impl_->color_maps = core::cache_lump_as_span<light_table_t>(data, "COLORMAP");
+        impl_->texture_info = init_textures(pool, data, setup);
+        impl_->color_maps = core::cache_lump_as_span<light_table_t>(data, "COLORMAP"_lump);
 
         for (int i = 0; i < light_levels; ++i)
         {
@@ -232,22 +209,87 @@ namespace rndr
 
     system::~system() = default;
 
-    void system::draw(const game::level_t& level, const game::mobj_t& player, core::game_data& data) const
+    system::precache_stats system::precache_level(const game::level_t& level, core::game_data& data) const
+    {
+        auto& pool = impl_->pool;
+        auto& info = impl_->texture_info;
+
+        const auto used = [](const std::vector<bool>& is_used) {
+            auto result = std::vector<size_t>();
+            for (size_t i = 0; i < is_used.size(); ++i)
+            {
+                if (is_used[i]) result.push_back(i);
+            }
+
+            return result;
+        };
+
+        auto is_texture_used = std::vector<bool>(info.textures.size());
+        is_texture_used[static_cast<size_t>(level.sky_texture)] = true;
+        for (const auto& side : level.sides)
+        {
+            for (const auto tex : {side.top_texture, side.bottom_texture, side.mid_texture})
+                is_texture_used[static_cast<size_t>(tex)] = true;
+        }
+
+        // texture 0 stands for no texture
+        is_texture_used[0] = false;
+
+        auto is_lump_used = std::vector<bool>(data.lumps.size());
+        for (const auto& sector : level.sectors)
+        {
+            for (const auto flat : {sector.floor_pic, sector.ceiling_pic})
+            {
+                if (flat != level.sky_flat_num) is_lump_used[static_cast<size_t>(flat)] = true;
+            }
+        }
+
+        // the flats are tagged for the level, so the cache doesn't evict them while the level is played
+        const auto flats = used(is_lump_used);
+        pool.parallel_for(flats.size(),
+                          [&](const size_t i) { core::preload_lump(data, flats[i], core::purge_tag::level); });
+
+        // textures are drawn from the column store, their patches aren't needed once the columns are built
+        const auto textures = used(is_texture_used);
+        pool.parallel_for(textures.size(),
+                          [&](const size_t i) { ensure_columns(data, static_cast<int>(textures[i]), info); });
+
+        auto stats = precache_stats{.num_textures = textures.size(), .num_flats = flats.size()};
+        for (const auto tex : textures)
+        {
+            const auto& texture = info.textures[tex];
+            stats.texture_bytes += static_cast<size_t>(texture.width) * static_cast<size_t>(texture.height);
+        }
+
+        // flats in mapped wads are drawn straight from the mapping
+        for (const auto num : flats)
+        {
+            if (data.lumps[num].mapped == nullptr) stats.flat_bytes += static_cast<size_t>(core::lump_size(data, num));
+        }
+
+        return stats;
+    }
+
+    void system::record(const game::level_t& level, const game::mobj_t& player, core::game_data& data,
+                        draw_commands& commands) const
     {
         if (!impl_->is_view_up_to_date)
         {
             impl_->view = create_view();
             rebuild_lighting_tables(impl_->view, impl_->color_maps, impl_->lighting_tables);
             impl_->is_view_up_to_date = true;
-            impl_->renderer.on_view_size_changed(impl_->view.width, impl_->view.height);
-        }
 
-        // todo debug only
-        std::ranges::fill(grfx::video_buffer, 112);
+            const auto num_strips = (impl_->mode == render_mode::strips) ? num_shares_for(impl_->pool) : 1;
+            impl_->strips = split_into_column_ranges(impl_->view.width, num_strips);
+            impl_->renderers.resize(impl_->strips.size());
+            impl_->strip_commands.resize(impl_->strips.size());
+            for (auto& renderer : impl_->renderers)
+                renderer.on_view_size_changed(impl_->view.width, impl_->view.height);
+        }
 
         const auto frame = frame_t{.position = player.position,
                                    .z = player.z,
-                                   .angle = player.angle,
+                                   .angle = core::bam(player.angle),
                                    .extra_light = 0};  // todo fill sensibly from player
 
         std::optional<std::span<const light_table_t>> fixed_color_map;
@@ -259,6 +301,8 @@ namespace rndr
         //}
 
         const auto context = context_t{.data = data,
+                                       .pool = impl_->pool,
+                                       .num_shares = (impl_->strips.size() == 1) ? num_shares_for(impl_->pool) : 1,
                                        .frame = frame,
                                        .level = level,
                                        .texture_info = impl_->texture_info,
@@ -267,17 +311,59 @@ namespace rndr
                                        .color_maps = impl_->color_maps,
                                        .fixed_color_map = fixed_color_map};
 
-        impl_->renderer.render_bsp_node(context, static_cast<int>(std::ssize(level.nodes) - 1));
+        commands.clear();
+        const auto root_node = static_cast<int>(std::ssize(level.nodes) - 1);
+        if (impl_->strips.size() == 1)
+        {
+            impl_->renderers[0].render_bsp_node(context, root_node, impl_->strips[0], commands);
+        }
+        else
+        {
+            impl_->pool.parallel_for(impl_->strips.size(), [&](const size_t i) {
+                impl_->strip_commands[i].clear();
+                impl_->renderers[i].render_bsp_node(context, root_node, impl_->strips[i], impl_->strip_commands[i]);
+            });
+
+            for (const auto& strip : impl_->strip_commands)
+                commands.append(strip);
+        }
+
+        if (impl_->order == command_order::by_texture) commands.sort_by_texture();
+    }
+
+    std::future<void> system::record_async(const game::level_t& level, const game::mobj_t& player,
+                                           core::game_data& data, draw_commands& commands) const
+    {
+        return impl_->pool.submit([this, &level, &player, &data, &commands] { record(level, player, data, commands); });
+    }
+
+    void system::rasterize(const draw_commands& commands, const framebuffer_view& target) const
+    {
+        const auto line_size = (target.layout == framebuffer_layout::row_major) ? target.width : target.height;
+        if ((target.width < impl_->view.width) || (target.height < impl_->view.height) || (target.pitch < line_size) ||
+            (target.pixels.size() < target.extent()))
+        {
+            throw std::invalid_argument(fmt::format("A {}x{} framebuffer can't hold the {}x{} view", target.width,
+                                                    target.height, impl_->view.width, impl_->view.height));
+        }
+
+        rndr::rasterize(commands, target, impl_->pool);
+    }
+
+    void system::draw(const game::level_t& level, const game::mobj_t& player, core::game_data& data,
+                      const framebuffer_view& target) const
+    {
+        record(level, player, data, impl_->frame_commands);
+        rasterize(impl_->frame_commands, target);
     }
 
-    int system::texture_num(const std::string& name) const
+    int system::texture_num(const core::lump_key name) const
     {
-        if (name == "-") return 0;
+        if (name == "-"_lump) return 0;
 
-        const auto it = std::ranges::find(impl_->texture_info.textures, name, &texture_t::name);
-        if (it == impl_->texture_info.textures.end())
-            throw std::runtime_error(fmt::format("There is no texture called `{}`", name));
+        const auto num = impl_->texture_info.texture_nums.find(name);
+        if (!num) throw std::runtime_error(fmt::format("There is no texture called `{}`", name.to_string()));
 
-        return static_cast<int>(std::distance(impl_->texture_info.textures.begin(), it));
+        return static_cast<int>(*num);
     }
 }
\ No newline at end of file
@@ -1,9 +1,17 @@
 #pragma once
 
 #include <core/game_data.hpp>
+#include <rndr/draw_commands.hpp>
+#include <rndr/framebuffer.hpp>
 
+#include <future>
 #include <memory>
 
+namespace core
+{
+    class thread_pool;
+}
+
 namespace game
 {
     struct level_t;
@@ -17,15 +25,69 @@ namespace grfx
 
 namespace rndr
 {
+    // Lazily set up textures get their column lookup generated when they are first drawn, eagerly set up
+    // ones all get it at startup (which is useful to take it out of frame time measurements)
+    enum class texture_setup
+    {
+        lazy,
+        eager
+    };
+
+    // Serial draws a frame on the calling thread. Strips splits the view into strips of columns that are drawn
+    // on the thread pool, each with clipping state and visplanes of its own. Both draw the same pixels.
+    enum class render_mode
+    {
+        serial,
+        strips
+    };
+
+    // The order recorded commands are left in. Sorting them by texture costs about a third of recording a frame
+    // and hasn't made rasterizing any faster, so it's only there to measure it.
+    enum class command_order
+    {
+        recorded,
+        by_texture
+    };
+
     class system
     {
     public:
-        explicit system(core::game_data& data);
+        system(core::game_data& data, core::thread_pool& pool, const texture_setup setup = texture_setup::lazy,
+               const render_mode mode = render_mode::serial, const command_order order = command_order::recorded);
         ~system();
 
-        void draw(const game::level_t& level, const game::mobj_t& player, core::game_data& data) const;
+        // What precache_level loaded and how much memory stays in use for it
+        struct precache_stats
+        {
+            size_t num_textures = 0;
+            size_t num_flats = 0;
+            size_t texture_bytes = 0;  // of the column store
+            size_t flat_bytes = 0;     // of the flats copied into the lump cache, they stay until the next level
+        };
+
+        // Builds the columns of all the textures the level uses and loads the level's flats on the thread
+        // pool, so none of this has to happen while the level is being drawn
+        [[nodiscard]] precache_stats precache_level(const game::level_t& level, core::game_data& data) const;
+
+        // Leaves what the frame needs drawn in commands, after clearing them. Nothing gets drawn into a
+        // framebuffer until the commands are rasterized, so the next frame can be recorded while the previous
+        // one is rasterized. Only one frame can be recorded at a time.
+        void record(const game::level_t& level, const game::mobj_t& player, core::game_data& data,
+                    draw_commands& commands) const;
+
+        // Records the frame on the thread pool. The arguments have to stay alive until the future is ready.
+        [[nodiscard]] std::future<void> record_async(const game::level_t& level, const game::mobj_t& player,
+                                                     core::game_data& data, draw_commands& commands) const;
+
+        // Draws recorded commands on the thread pool. The view has the original screen size, the target must
+        // be at least that big.
+        void rasterize(const draw_commands& commands, const framebuffer_view& target) const;
+
+        // Records the frame and rasterizes it
+        void draw(const game::level_t& level, const game::mobj_t& player, core::game_data& data,
+                  const framebuffer_view& target) const;
 
-        [[nodiscard]] int texture_num(const std::string& name) const;
+        [[nodiscard]] int texture_num(const core::lump_key name) const;
 
     private:
         struct impl;
@@ -0,0 +1,188 @@
+#include <rndr/texture_info.hpp>
+
+#include <core/game_data.hpp>
+#include <grfx/system.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <new>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+
+namespace rndr
+{
+    namespace
+    {
+        // Where each column of a texture comes from: single patch columns are read straight out of their
+        // patch lump, the others out of the composite.
+        struct lookup_t
+        {
+            std::vector<int> column_lump;
+            std::vector<unsigned> column_offset;
+            int composite_size = 0;
+        };
+
+        void draw_column_in_cache(const grfx::column_view& col, const std::span<std::uint8_t> cache, const int y)
+        {
+            for (const auto& post : col)
+            {
+                const auto raw_target_pos = y + post.top_delta;
+                const auto target_pos = std::max(0, raw_target_pos);
+                const auto max_pos = std::ssize(cache) - target_pos;
+                const auto negative_offset = raw_target_pos - target_pos;
+                const auto count = std::clamp(std::ssize(post.pixels) + negative_offset, 0L, max_pos);
+                std::ranges::copy(post.pixels.subspan(0, count), cache.data() + target_pos);
+            }
+        }
+
+        lookup_t generate_lookup(core::game_data& data, const int tex_num, const texture_t& texture)
+        {
+            auto result = lookup_t{.column_lump = std::vector<int>(texture.width, 0),
+                                   .column_offset = std::vector<unsigned>(texture.width, 0)};
+            auto& col_lump = result.column_lump;
+            auto& col_offset = result.column_offset;
+
+            // Now count the number of columns
+            //  that are covered by more than one patch.
+            // Fill in the lump / offset, so columns
+            //  with only a single patch are all done.
+            auto patch_count = std::vector<std::uint8_t>(texture.width, 0);
+
+            for (const auto& patch : texture.patches)
+            {
+                const auto& real_patch =
+                    *core::cache_lump_num<grfx::patch_t>(data, patch.patch, core::purge_tag::purgeable);
+                const auto col_offsets = std::span(&real_patch.first_column_offset, real_patch.width);
+                const auto x1 = patch.origin_x;
+                const auto x2 = std::min(static_cast<short>(x1 + real_patch.width), texture.width);
+
+                for (auto x = std::max(short(0), x1); x < x2; ++x)
+                {
+                    patch_count[x]++;
+                    col_lump[x] = patch.patch;
+                    col_offset[x] = col_offsets[x - x1] + 3;
+                }
+            }
+
+            for (auto x = 0; x < texture.width; x++)
+            {
+                if (patch_count[x] == 0)
+                {
+                    fmt::print("generate_lookup: column without a patch ({})\n", texture.name);
+                    return result;
+                }
+
+                if (patch_count[x] > 1)
+                {
+                    // Use the cached block.
+                    col_lump[x] = -1;
+                    col_offset[x] = result.composite_size;
+
+                    if (result.composite_size > 0x10000 - texture.height)
+                        throw std::runtime_error(fmt::format("generate_lookup: texture {} is >64k", tex_num));
+
+                    result.composite_size += texture.height;
+                }
+            }
+
+            return result;
+        }
+
+        std::vector<std::uint8_t> generate_composite(core::game_data& data, const texture_t& texture,
+                                                     const lookup_t& lookup)
+        {
+            auto composite = std::vector<std::uint8_t>(lookup.composite_size);
+
+            const auto& offsets = lookup.column_offset;
+            const auto target_span = [&, size = texture.height](const int x) {
+                return std::span(composite.data() + offsets[x], size);
+            };
+
+            const auto column_has_multiple_patches = [&lump = lookup.column_lump](const int x) { return lump[x] < 0; };
+
+            // Composite the columns together.
+            for (const auto& tex_patch : texture.patches)
+            {
+                const auto& real_patch =
+                    *core::cache_lump_num<grfx::patch_t>(data, tex_patch.patch, core::purge_tag::purgeable);
+                const auto x1 = static_cast<int>(tex_patch.origin_x);
+                const auto x2 = std::min(x1 + real_patch.width, static_cast<int>(texture.width));
+
+                for (auto x = std::max(0, x1); const auto& col : grfx::columns(real_patch) | std::views::take(x2 - x))
+                {
+                    if (column_has_multiple_patches(x)) draw_column_in_cache(col, target_span(x), tex_patch.origin_y);
+
+                    ++x;
+                }
+            }
+
+            return composite;
+        }
+
+        // Copies as much of the source as there is, a broken texture can refer to bytes past its end
+        void copy_column(const std::span<const std::uint8_t> source, const size_t offset,
+                         const std::span<std::uint8_t> target)
+        {
+            const auto available = (offset < source.size()) ? std::min(source.size() - offset, target.size()) : 0;
+            std::ranges::copy(source.subspan(offset, available), target.begin());
+            std::ranges::fill(target.subspan(available), 0);
+        }
+    }
+
+    void column_store_delete::operator()(std::uint8_t* store) const
+    {
+        ::operator delete[](store, std::align_val_t{column_store_alignment});
+    }
+
+    void init_column_store(texture_info_t& info)
+    {
+        info.columns.resize(info.textures.size());
+
+        auto size = size_t{0};
+        for (auto i = size_t{0}; i < info.textures.size(); ++i)
+        {
+            const auto& texture = info.textures[i];
+
+            unsigned j = 1;
+            while (j * 2 <= static_cast<unsigned>(texture.width))
+                j <<= 1;
+
+            info.columns[i] = {.offset = size, .width_mask = j - 1, .height = static_cast<unsigned>(texture.height)};
+
+            const auto texture_size = static_cast<size_t>(texture.width) * static_cast<size_t>(texture.height);
+            size += (texture_size + column_store_alignment - 1) & ~(column_store_alignment - 1);
+        }
+
+        info.column_store.reset(static_cast<std::uint8_t*>(
+            ::operator new[](std::max(size, size_t{1}), std::align_val_t{column_store_alignment})));
+        info.has_columns = std::make_unique<std::once_flag[]>(info.textures.size());
+    }
+
+    void build_columns(core::game_data& data, const int tex_num, texture_info_t& info)
+    {
+        const auto& texture = info.textures[tex_num];
+        const auto lookup = generate_lookup(data, tex_num, texture);
+        const auto composite = (lookup.composite_size > 0) ? generate_composite(data, texture, lookup)
+                                                           : std::vector<std::uint8_t>();
+
+        const auto height = static_cast<size_t>(texture.height);
+        auto* const target = info.column_store.get() + info.columns[tex_num].offset;
+        for (auto x = size_t{0}; x < static_cast<size_t>(texture.width); ++x)
+        {
+            const auto lump = lookup.column_lump[x];
+            const auto column = std::span(target + x * height, height);
+            if (lump > 0)
+            {
+                const auto patch = core::cache_lump_num_as_span<std::uint8_t>(data, static_cast<size_t>(lump),
+                                                                              core::purge_tag::purgeable);
+                copy_column(patch, lookup.column_offset[x], column);
+            }
+            else
+            {
+                copy_column(composite, lookup.column_offset[x], column);
+            }
+        }
+    }
+}
@@ -1,10 +1,21 @@
 #pragma once
 
+#include <core/lump_index.hpp>
 #include <core/units.hpp>
 
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
 #include <string>
 #include <vector>
 
+namespace core
+{
+    struct game_data;
+}
+
 namespace rndr
 {
     struct texture_patch_t
@@ -22,14 +33,56 @@ namespace rndr
         std::vector<texture_patch_t> patches;
     };
 
+    // Where the columns of a texture are in the column store. Column x of the texture starts at
+    // offset + (x & width_mask) * height.
+    struct texture_columns_t
+    {
+        size_t offset = 0;
+        unsigned width_mask = 0;
+        unsigned height = 0;
+    };
+
+    struct column_store_delete
+    {
+        void operator()(std::uint8_t* store) const;
+    };
+
     struct texture_info_t
     {
         std::vector<texture_t> textures;
-        std::vector<int> width_mask;
+
+        // texture numbers by name, if several textures have the same name the first one is used
+        core::lump_index texture_nums;
         std::vector<core::units> height;
-        std::vector<std::vector<int>> column_lump;
-        std::vector<std::vector<unsigned>> column_offset;
-        std::vector<int> composite_size;
-        std::vector<std::vector<std::uint8_t>> composite;
+
+        // Every column of every texture as a dense run of texels, whether it comes from a single patch or is
+        // composited from several. Each texture starts on a cache line. The store is sized for all textures up
+        // front, but the columns of a texture are only filled in when it is first drawn or precached (see
+        // ensure_columns), so most of it is never touched for a given map.
+        std::vector<texture_columns_t> columns;
+        std::unique_ptr<std::uint8_t[], column_store_delete> column_store;
+        std::unique_ptr<std::once_flag[]> has_columns;
     };
-}
\ No newline at end of file
+
+    constexpr auto column_store_alignment = size_t{64};
+
+    // Allocates the column store for the textures and sets up their descriptors
+    void init_column_store(texture_info_t& info);
+
+    void build_columns(core::game_data& data, const int tex_num, texture_info_t& info);
+
+    // Safe to call from several threads, the columns of each texture are built exactly once
+    inline void ensure_columns(core::game_data& data, const int tex_num, texture_info_t& info)
+    {
+        std::call_once(info.has_columns[tex_num], build_columns, std::ref(data), tex_num, std::ref(info));
+    }
+
+    // Needs the columns of the texture
+    inline std::span<const std::uint8_t> texture_column(const texture_info_t& info, const int tex_num,
+                                                        const unsigned column)
+    {
+        const auto& columns = info.columns[tex_num];
+        return {info.column_store.get() + columns.offset + (column & columns.width_mask) * columns.height,
+                columns.height};
+    }
+}
@@ -1,28 +1,40 @@
 #include <rndr/trigonometry.hpp>
 
+#include <rndr/view.hpp>
+
 #include <algorithm>
+#include <cmath>
 
 namespace rndr
 {
-    core::radians point_to_angle(const frame_t& frame, const core::pos p)
+    core::bam point_to_angle(const frame_t& frame, const core::pos p)
     {
         auto d = p - frame.position;
-        return atan2(d.y, d.x);
+        return core::point_to_bam(static_cast<real>(d.x), static_cast<real>(d.y));
     }
 
-    int view_angle_to_x(const int view_width, const core::radians clip_angle, const core::radians view_angle)
+    int view_angle_to_x(const view_t& view, const core::bam view_angle)
     {
-        const auto half_view_width = view_width * 0.5;
-        const auto focal_length = tan(clip_angle) * half_view_width;
-        const auto offset_from_center = tan(view_angle) * focal_length;
-        const auto x = static_cast<int>(half_view_width - offset_from_center + 1.0);
-        return std::clamp(x, 0, view_width);
+        return view.angle_to_x[(view_angle + core::ang90).fine_index()];
     }
 
-    core::radians x_to_view_angle(const int view_width, const core::radians clip_angle, const int x)
+    core::bam x_to_view_angle(const view_t& view, const int x) { return view.x_to_angle[x]; }
+
+    void build_view_angle_tables(view_t& view)
     {
-        const auto half_view_width = view_width * 0.5;
-        const auto focal_length = tan(clip_angle) * half_view_width;
-        return normalize(core::atan((half_view_width - x) / focal_length));
+        const auto half_view_width = view.width * 0.5;
+        const auto focal_length = tan(view.clip_angle.to_radians()) * half_view_width;
+
+        view.x_to_angle.resize(static_cast<size_t>(view.width) + 1);
+        for (int x = 0; x <= view.width; ++x)
+            view.x_to_angle[x] = core::bam(normalize(core::atan((half_view_width - x) / focal_length)));
+
+        view.angle_to_x.resize(core::fine_tangents.size());
+        for (size_t i = 0; i < core::fine_tangents.size(); ++i)
+        {
+            const auto offset_from_center = core::fine_tangents[i] * focal_length;
+            const auto x = static_cast<int>(half_view_width - offset_from_center + 1.0);
+            view.angle_to_x[i] = std::clamp(x, 0, view.width);
+        }
     }
-}
\ No newline at end of file
+}
@@ -1,12 +1,18 @@
 #pragma once
 
-#include <core/radians.hpp>
+#include <core/bam.hpp>
 #include <core/vec.hpp>
 #include <rndr/frame.hpp>
 
 namespace rndr
 {
-    core::radians point_to_angle(const frame_t& frame, const core::pos pos);
-    int view_angle_to_x(const int view_width, const core::radians clip_angle, const core::radians view_angle);
-    core::radians x_to_view_angle(const int view_width, const core::radians clip_angle, const int x);
-}
\ No newline at end of file
+    struct view_t;
+
+    core::bam point_to_angle(const frame_t& frame, const core::pos pos);
+    int view_angle_to_x(const view_t& view, const core::bam view_angle);
+    core::bam x_to_view_angle(const view_t& view, const int x);
+
+    // Fills in the tables behind view_angle_to_x and x_to_view_angle, which only change with the size of the
+    // view. That keeps the standard library's trigonometry out of drawing a frame.
+    void build_view_angle_tables(view_t& view);
+}
@@ -1,8 +1,10 @@
 #pragma once
 
-#include <core/radians.hpp>
+#include <core/bam.hpp>
 #include <core/units.hpp>
 
+#include <vector>
+
 namespace rndr
 {
     struct view_t
@@ -17,6 +19,11 @@ namespace rndr
 
         core::units projection;
 
-        core::radians clip_angle;
+        core::bam clip_angle;
+
+        // the angle of every column edge, relative to the view direction, see build_view_angle_tables
+        std::vector<core::bam> x_to_angle;
+        // the column of every fine angle from -90° up to 90° relative to the view direction
+        std::vector<int> angle_to_x;
     };
-}
\ No newline at end of file
+}
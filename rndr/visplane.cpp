@@ -1,12 +1,17 @@
 #include <rndr/visplane.hpp>
 
+#include <core/thread_pool.hpp>
 #include <game/level.hpp>
 #include <rndr/column.hpp>
 #include <rndr/context.hpp>
+#include <rndr/draw_commands.hpp>
 #include <rndr/sky.hpp>
 #include <rndr/texture_info.hpp>
 #include <rndr/trigonometry.hpp>
 
+#include <algorithm>
+#include <limits>
+#include <span>
 #include <vector>
 
 namespace rndr
@@ -17,54 +22,29 @@ namespace rndr
 
         constexpr auto plane_sky_flat = 0x80000000;
 
-        struct span_t
-        {
-            unsigned int y = 0;
-            int x_start = 0;
-            int x_end = 0;
-            core::units u_start;
-            core::units v_start;
-            core::units u_step;
-            core::units v_step;
-            std::span<const std::uint8_t> source;
-            std::span<const light_table_t> color_map;
-            int view_width = 0;
-
-            // std::uint8_t* bright_map;
-        };
-
-        auto source_pixel(const core::units u, const core::units v, const std::span<const std::uint8_t> source)
-        {
-            // const auto index = ((v.raw_value() >> (16 - 6)) & (63 * 64)) + (static_cast<int>(u) & 63);
-            const auto index = (static_cast<int>(v * 64) & (63 * 64)) + (static_cast<int>(u) & 63);
-            return source[index];
-        }
+        constexpr auto num_plane_buckets = size_t{128};
+        constexpr auto no_plane = std::numeric_limits<size_t>::max();
 
-        void draw_span(const span_t& ds)
+        size_t plane_bucket(const core::units height, const int pic_num, const int light_level)
         {
-            const auto span_size = ds.x_end - ds.x_start;
-            const auto dest_pixels = grfx::video_buffer.subspan(ds.y * ds.view_width + ds.x_start, span_size);
-            auto u = ds.u_start;
-            auto v = ds.v_start;
-            for (auto& dest_pixel : dest_pixels)
-            {
-                dest_pixel = ds.color_map[source_pixel(u, v, ds.source)];
-
-                u += ds.u_step;
-                v += ds.v_step;
-            }
+            // the heights of the planes in a map are whole numbers
+            const auto hash = (static_cast<unsigned int>(pic_num) * 3U) + static_cast<unsigned int>(light_level)
+                              + (static_cast<unsigned int>(static_cast<int>(height)) * 7U);
+            return hash & (num_plane_buckets - 1);
         }
 
-        void draw_sky_plane(const context_t& context, const visplane_t& pl)
+        void draw_sky_plane(const context_t& context, const visplane_t& pl, draw_commands& commands)
         {
             // Sky is always drawn full bright,
             //  i.e. color_maps[0] is used.
             // Because of this hack, sky is not affected
             //  by INVUL inverse mapping.
             // todo this should be computed in rndr::system when the view size changes
-            const auto pspriteiscale = real{1};
-            auto dc = draw_column_t{
-                .color_map = context.color_maps, .fraction_step = pspriteiscale, .texture_mid = sky_texture_mid};
+            const auto pspriteiscale = number{1};
+            auto dc = draw_column_t{.color_map = context.color_maps,
+                                    .fraction_step = pspriteiscale,
+                                    .texture_mid = static_cast<number>(sky_texture_mid)};
+            ensure_columns(context.data, context.level.sky_texture, context.texture_info);
 
             for (int x = pl.min_x; x <= pl.max_x; ++x)
             {
@@ -75,24 +55,20 @@ namespace rndr
                 {
                     dc.y_start = static_cast<int>(y_start);
                     dc.y_end = static_cast<int>(y_end);
-                    const auto view_angle = x_to_view_angle(context.view.width, context.view.clip_angle, x);
-                    const auto col =
-                        static_cast<unsigned int>(to_fraction(context.frame.angle + view_angle) * sky_column_factor);
+                    const auto view_angle = x_to_view_angle(context.view, x);
+                    const auto col = (context.frame.angle + view_angle).raw_value() >> angle_to_sky_shift;
                     dc.x = x;
                     dc.source = get_column(context, context.level.sky_texture, col);
-                    draw_column(context.view, dc);
+                    add_column_command(context, dc, commands);
                 }
             }
         }
     }
 
-    struct visplanes::impl
+    // Turning planes into spans keeps track of where the spans start and caches the texture mapping of
+    // every row, so each thread needs one of these for itself
+    struct visplanes::span_builder
     {
-        std::vector<visplane_t> visplanes;
-        // visplane_t* floor_plane = nullptr;
-        // visplane_t* ceiling_plane = nullptr;
-        // int num_visplanes = 0;
-
         //
         // span_start holds the start of a plane span
         // initialized to 0 at start
@@ -106,13 +82,34 @@ namespace rndr
         const std::array<std::span<const light_table_t>, max_light_z>* plane_z_light = nullptr;
         core::units plane_height;
 
+        std::array<core::units, grfx::max_screen_height> cached_height{};
+        std::array<number, grfx::max_screen_height> cached_distance{};
+        std::array<number, grfx::max_screen_height> cached_x_step{};
+        std::array<number, grfx::max_screen_height> cached_y_step{};
+
+        draw_commands commands;
+    };
+
+    struct visplanes::impl
+    {
+        std::vector<visplane_t> visplanes;
+
+        // The planes find_plane_index made, chained by their height, pic and light level. The planes
+        // check_plane_index splits off them never get looked up, so they aren't in here.
+        std::array<size_t, num_plane_buckets> buckets = [] {
+            auto result = std::array<size_t, num_plane_buckets>();
+            result.fill(no_plane);
+            return result;
+        }();
+        std::vector<size_t> next_in_bucket;
+        // visplane_t* floor_plane = nullptr;
+        // visplane_t* ceiling_plane = nullptr;
+        // int num_visplanes = 0;
+
         std::array<real, grfx::screen_height> y_slope{};
         // std::array<real, grfx::max_screen_width> dist_scale{};
 
-        std::array<core::units, grfx::max_screen_height> cached_height{};
-        std::array<core::units, grfx::max_screen_height> cached_distance{};
-        std::array<core::units, grfx::max_screen_height> cached_x_step{};
-        std::array<core::units, grfx::max_screen_height> cached_y_step{};
+        std::vector<span_builder> builders;
     };
 
     visplanes::visplanes() : impl_(std::make_unique<impl>()) {}
@@ -134,95 +131,117 @@ namespace rndr
     void visplanes::clear()
     {
         impl_->visplanes.clear();
-        std::ranges::fill(impl_->cached_height, 0_u);
+        impl_->buckets.fill(no_plane);
+        impl_->next_in_bucket.clear();
     }
 
-    void visplanes::map(const frame_t& frame, const view_t& view, const std::span<const std::uint8_t> source,
-                        const std::optional<std::span<const light_table_t>>& fixed_color_map, const unsigned int y,
-                        const int x1, const int x2)
+    void visplanes::map(const context_t& context, span_builder& builder, const std::span<const std::uint8_t> source,
+                        const unsigned int y, const int x1, const int x2) const
     {
+        const auto& frame = context.frame;
+        const auto& view = context.view;
         const auto dy = static_cast<real>(abs(view.center_y - static_cast<int>(y)));
         if (dy == 0) return;
 
-        const auto view_sin = sin(frame.angle);
-        const auto view_cos = cos(frame.angle);
+        const auto view_sin = static_cast<number>(sin(frame.angle));
+        const auto view_cos = static_cast<number>(cos(frame.angle));
 
-        if (impl_->plane_height != impl_->cached_height[y])
+        if (builder.plane_height != builder.cached_height[y])
         {
-            impl_->cached_height[y] = impl_->plane_height;
-            impl_->cached_distance[y] = impl_->plane_height * impl_->y_slope[y];
-            impl_->cached_x_step[y] = (view_sin * impl_->plane_height) / dy;
-            impl_->cached_y_step[y] = (view_cos * impl_->plane_height) / dy;
+            const auto plane_height = to_number(builder.plane_height);
+            builder.cached_height[y] = builder.plane_height;
+            builder.cached_distance[y] = plane_height * static_cast<number>(impl_->y_slope[y]);
+            builder.cached_x_step[y] = (view_sin * plane_height) / static_cast<number>(dy);
+            builder.cached_y_step[y] = (view_cos * plane_height) / static_cast<number>(dy);
         }
 
-        const auto dx = static_cast<real>(x1 - view.center_x);
-        const auto distance = impl_->cached_distance[y];
-        const auto u_step = impl_->cached_x_step[y];
-        const auto v_step = impl_->cached_y_step[y];
-
-        draw_span({.y = y,
-                   .x_start = x1,
-                   .x_end = x2,
-                   .u_start = frame.position.x + (view_cos * distance) + dx * u_step,
-                   .v_start = -frame.position.y - (view_sin * distance) + dx * v_step,
-                   .u_step = u_step,
-                   .v_step = v_step,
-                   .source = source,
-                   .color_map = fixed_color_map ? *fixed_color_map
-                                                : (*impl_->plane_z_light)[std::clamp(
-                                                    static_cast<int>(distance * light_z_factor), 0, max_light_z - 1)],
-                   .view_width = view.width});
+        const auto distance = builder.cached_distance[y];
+        const auto u_step = builder.cached_x_step[y];
+        const auto v_step = builder.cached_y_step[y];
+        const auto light_z =
+            std::clamp(static_cast<int>(distance * static_cast<number>(light_z_factor)), 0, max_light_z - 1);
+
+        builder.commands.spans.push_back(
+            {.y = static_cast<int>(y),
+             .x_start = x1,
+             .x_end = x2,
+             .center_x = view.center_x,
+             .u_center = to_number(frame.position.x) + (view_cos * distance),
+             .v_center = -to_number(frame.position.y) - (view_sin * distance),
+             .u_step = u_step,
+             .v_step = v_step,
+             .source = source,
+             .color_map = context.fixed_color_map ? *context.fixed_color_map : (*builder.plane_z_light)[light_z]});
     }
 
-    void visplanes::make_spans(const frame_t& frame, const view_t& view, const std::span<const std::uint8_t> source,
-                               const std::optional<std::span<const light_table_t>>& fixed_color_map, const int x,
-                               unsigned int t1, unsigned int b1, unsigned int t2, unsigned int b2)
+    void visplanes::make_spans(const context_t& context, span_builder& builder,
+                               const std::span<const std::uint8_t> source, const int x, unsigned int t1,
+                               unsigned int b1, unsigned int t2, unsigned int b2) const
     {
         while (t1 < t2 && t1 <= b1)
         {
-            map(frame, view, source, fixed_color_map, t1, impl_->span_start[t1], x);
+            map(context, builder, source, t1, builder.span_start[t1], x);
             t1++;
         }
         while (b1 > b2 && b1 >= t1)
         {
-            map(frame, view, source, fixed_color_map, b1, impl_->span_start[b1], x);
+            map(context, builder, source, b1, builder.span_start[b1], x);
             b1--;
         }
 
         while (t2 < t1 && t2 <= b2)
         {
-            impl_->span_start[t2] = x;
+            builder.span_start[t2] = x;
             t2++;
         }
         while (b2 > b1 && b2 >= t2)
         {
-            impl_->span_start[b2] = x;
+            builder.span_start[b2] = x;
             b2--;
         }
     }
 
-    void visplanes::draw(const context_t& context)
+    void visplanes::draw(const context_t& context, draw_commands& commands)
     {
-        for (auto& pl : impl_->visplanes)
-        {
-            if (pl.min_x > pl.max_x) continue;
+        auto& planes = impl_->visplanes;
+        if (planes.empty()) return;
 
-            if (pl.pic_num == context.level.sky_flat_num)
-                draw_sky_plane(context, pl);
-            else
-                draw_regular_plane(context, pl);
-        }
+        // The planes are dealt out round robin, which spreads big and small planes evenly over the threads.
+        // Each share has a span builder of its own. Drawing in strips already keeps the pool busy, then each
+        // strip draws its planes in a single share.
+        const auto num_shares = std::min(planes.size(), context.num_shares);
+        if (impl_->builders.size() < num_shares) impl_->builders.resize(num_shares);
+
+        context.pool.parallel_for(num_shares, [&](const size_t share) {
+            auto& builder = impl_->builders[share];
+            builder.commands.clear();
+            std::ranges::fill(builder.cached_height, 0_u);
+
+            for (auto i = share; i < planes.size(); i += num_shares)
+            {
+                auto& pl = planes[i];
+                if (pl.min_x > pl.max_x) continue;
+
+                if (pl.pic_num == context.level.sky_flat_num)
+                    draw_sky_plane(context, pl, builder.commands);
+                else
+                    draw_regular_plane(context, builder, pl);
+            }
+        });
+
+        for (size_t share = 0; share < num_shares; ++share)
+            commands.append(impl_->builders[share].commands);
     }
 
-    void visplanes::draw_regular_plane(const context_t& context, visplane_t& pl)
+    void visplanes::draw_regular_plane(const context_t& context, span_builder& builder, visplane_t& pl) const
     {
-        const auto source = core::cache_lump_num_as_span<uint8_t>(context.data, pl.pic_num);
+        const auto source = core::cache_lump_num_as_span<uint8_t>(context.data, pl.pic_num, core::purge_tag::purgeable);
 
-        impl_->plane_height = abs(pl.height - context.frame.z);
+        builder.plane_height = abs(pl.height - context.frame.z);
         const auto light = std::clamp((pl.light_level >> light_seg_shift) + (context.frame.extra_light * light_bright),
                                       0, light_levels - 1);
 
-        impl_->plane_z_light = &context.lighting_tables.z_light[light];
+        builder.plane_z_light = &context.lighting_tables.z_light[light];
 
         pl.top[pl.max_x + 2] = 0xffffffffU;
         pl.top[pl.min_x] = 0xffffffffU;
@@ -230,10 +249,7 @@ namespace rndr
         const auto stop = pl.max_x + 1;
 
         for (auto x = pl.min_x; x <= stop; x++)
-        {
-            make_spans(context.frame, context.view, source, context.fixed_color_map, x, pl.top[x], pl.bottom[x],
-                       pl.top[x + 1], pl.bottom[x + 1]);
-        }
+            make_spans(context, builder, source, x, pl.top[x], pl.bottom[x], pl.top[x + 1], pl.bottom[x + 1]);
     }
 
     size_t visplanes::find_plane_index(const int sky_flat_num, core::units height, const int pic_num, int light_level)
@@ -244,30 +260,38 @@ namespace rndr
             light_level = 0;
         }
 
-        const auto it = std::ranges::find_if(impl_->visplanes, [&](const visplane_t& p) {
-            return (p.height == height) && (p.pic_num == pic_num) && (p.light_level == light_level);
-        });
-
-        if (it != impl_->visplanes.end()) return std::distance(impl_->visplanes.begin(), it);
+        auto& first_in_bucket = impl_->buckets[plane_bucket(height, pic_num, light_level)];
+        for (auto i = first_in_bucket; i != no_plane; i = impl_->next_in_bucket[i])
+        {
+            const auto& p = impl_->visplanes[i];
+            if ((p.height == height) && (p.pic_num == pic_num) && (p.light_level == light_level)) return i;
+        }
 
         impl_->visplanes.push_back({.height = height,
                                     .pic_num = pic_num,
                                     .light_level = light_level,
                                     .min_x = grfx::standard_screen_width,
                                     .max_x = -1});
-        return impl_->visplanes.size() - 1;
+
+        const auto index = impl_->visplanes.size() - 1;
+        impl_->next_in_bucket.resize(impl_->visplanes.size());
+        impl_->next_in_bucket[index] = first_in_bucket;
+        first_in_bucket = index;
+        return index;
     }
 
     size_t visplanes::check_plane_index(const size_t index, const int start, const int stop)
     {
         auto& pl = impl_->visplanes[index];
 
-        const auto union_low = std::min(start, pl.min_x);
+        const auto [union_low, intersect_low] = std::minmax(start, pl.min_x);
         const auto [intersect_high, union_high] = std::minmax(stop, pl.max_x);
 
-        const auto* const it = std::ranges::find_if(pl.top, [](const auto t) { return t != 0xffffffffU; });
-
-        if ((it != pl.top.end()) && (*it > intersect_high))
+        // The plane can only be extended if it doesn't cover any of the columns yet. Checking against the
+        // marked columns rather than every column in between can split off a plane that didn't need to be,
+        // which draws the same pixels.
+        if ((intersect_low > intersect_high) || (pl.max_marked_x < intersect_low)
+            || (pl.min_marked_x > intersect_high))
         {
             pl.min_x = union_low;
             pl.max_x = union_high;
@@ -283,7 +307,10 @@ namespace rndr
 
     void visplanes::set_extents(const size_t index, const int x, const int bottom, const int top)
     {
-        impl_->visplanes[index].bottom[x + 1] = bottom;
-        impl_->visplanes[index].top[x + 1] = top;
+        auto& pl = impl_->visplanes[index];
+        pl.bottom[x + 1] = bottom;
+        pl.top[x + 1] = top;
+        pl.min_marked_x = std::min(pl.min_marked_x, x);
+        pl.max_marked_x = std::max(pl.max_marked_x, x);
     }
 }
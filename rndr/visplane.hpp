@@ -8,12 +8,14 @@
 #include <rndr/view.hpp>
 
 #include <array>
+#include <limits>
 #include <memory>
 #include <span>
 
 namespace rndr
 {
     struct context_t;
+    struct draw_commands;
 
     struct visplane_t
     {
@@ -23,7 +25,16 @@ namespace rndr
         int min_x = 0;
         int max_x = 0;
 
-        std::array<unsigned int, grfx::max_screen_width + 2> top{0xffffffffU};
+        // the columns set_extents has been called for lie between these
+        int min_marked_x = std::numeric_limits<int>::max();
+        int max_marked_x = std::numeric_limits<int>::min();
+
+        // columns the plane doesn't cover have a top of 0xffffffff
+        std::array<unsigned int, grfx::max_screen_width + 2> top = [] {
+            auto result = std::array<unsigned int, grfx::max_screen_width + 2>();
+            result.fill(0xffffffffU);
+            return result;
+        }();
         std::array<unsigned int, grfx::max_screen_width + 2> bottom{};
     };
 
@@ -42,15 +53,9 @@ namespace rndr
 
         void calculate_y_slope(const int w, const int h);
 
-        void map(const frame_t& frame, const view_t& view, const std::span<const std::uint8_t> source,
-                 const std::optional<std::span<const light_table_t>>& fixed_color_map, const unsigned int y, const int x1,
-                 const int x2);
-
-        void make_spans(const frame_t& frame, const view_t& view, const std::span<const std::uint8_t> source,
-                        const std::optional<std::span<const light_table_t>>& fixed_color_map, const int x,
-                        unsigned int t1, unsigned int b1, unsigned int t2, unsigned int b2);
-
-        void draw(const context_t& context);
+        // Leaves the spans and sky columns of the planes to the rasterizer. The planes are shared out over the
+        // thread pool in as many shares as the context allows.
+        void draw(const context_t& context, draw_commands& commands);
 
         size_t find_plane_index(const int sky_flat_num, core::units height, const int pic_num, int light_level);
 
@@ -59,7 +64,15 @@ namespace rndr
         void set_extents(const size_t index, const int x, const int bottom, const int top);
 
     private:
-        void draw_regular_plane(const context_t& context, visplane_t& pl);
+        struct span_builder;
+
+        void map(const context_t& context, span_builder& builder, const std::span<const std::uint8_t> source,
+                 const unsigned int y, const int x1, const int x2) const;
+
+        void make_spans(const context_t& context, span_builder& builder, const std::span<const std::uint8_t> source,
+                        const int x, unsigned int t1, unsigned int b1, unsigned int t2, unsigned int b2) const;
+
+        void draw_regular_plane(const context_t& context, span_builder& builder, visplane_t& pl) const;
 
         struct impl;
         std::unique_ptr<impl> impl_;
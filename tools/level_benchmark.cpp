@@ -0,0 +1,253 @@
+// Loads every map of a wad stack a number of times without opening a window and writes how long each stage
+// of loading took, and what precaching kept in memory, as CSV to a file (stdout gets the engine's messages):
+//
+//     level_benchmark [--runs n] [--threads n] [--csv file] [--levelcache dir] [wad...]
+//
+// The first wad is the IWAD, the others are mounted on top of it in order. Without any wads the IWAD is
+// looked for the same way the game does. Every run sets up the textures, loads the level and precaches its
+// textures and flats from scratch, so the runs of a map measure the same work. With --levelcache each run
+// also loads the map through a level cache in dir, once with the map's cache file removed (cold) and once
+// reading the file that load wrote (warm).
+
+#include <core/game_data.hpp>
+#include <core/thread_pool.hpp>
+#include <game/level.hpp>
+#include <game/level_cache.hpp>
+#include <rndr/system.hpp>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using milliseconds = std::chrono::duration<double, std::milli>;
+
+    struct options_t
+    {
+        size_t runs = 5;
+        size_t threads = std::thread::hardware_concurrency();
+        std::filesystem::path csv = "level_benchmark.csv";
+        std::filesystem::path level_cache_dir;  // empty to not measure the level cache
+        std::vector<std::filesystem::path> wads;
+    };
+
+    options_t parse_options(const std::span<char*> args)
+    {
+        auto result = options_t();
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const auto arg = std::string_view(args[i]);
+            const auto value = [&] {
+                if (i + 1 == args.size()) throw std::runtime_error(fmt::format("{} needs a value", arg));
+
+                return std::string_view(args[++i]);
+            };
+
+            if (arg == "--runs")
+                result.runs = std::stoul(std::string(value()));
+            else if (arg == "--threads")
+                result.threads = std::stoul(std::string(value()));
+            else if (arg == "--csv")
+                result.csv = value();
+            else if (arg == "--levelcache")
+                result.level_cache_dir = value();
+            else
+                result.wads.emplace_back(arg);
+        }
+
+        if (result.runs == 0) throw std::runtime_error("--runs has to be at least 1");
+
+        return result;
+    }
+
+    // The labels of all maps that can be loaded, later wads replace maps of the same name
+    std::vector<std::string> map_names(const core::game_data& data)
+    {
+        auto result = std::vector<std::string>();
+        for (size_t i = 0; i < data.lumps.size(); ++i)
+        {
+            const auto name = data.lumps[i].name;
+            if (core::find_lump_num(data, name, core::lump_namespace::maps) == i) result.push_back(name.to_string());
+        }
+
+        return result;
+    }
+
+    template <typename Func>
+    milliseconds measure(Func&& func)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        func();
+        return std::chrono::steady_clock::now() - start;
+    }
+
+    struct row_t
+    {
+        std::string map;
+        std::string run;
+        std::string stage;
+        milliseconds start{};
+        milliseconds duration{};
+        std::optional<size_t> value;  // rows that count something instead of timing a stage
+    };
+
+    void print(FILE* file, const row_t& row)
+    {
+        if (row.value)
+        {
+            fmt::print(file, "{},{},{},,,{}\n", row.map, row.run, row.stage, *row.value);
+            return;
+        }
+
+        fmt::print(file, "{},{},{},{:.3f},{:.3f},\n", row.map, row.run, row.stage, row.start.count(),
+                   row.duration.count());
+    }
+
+    // One run of loading a map: sets up the textures, loads the level and precaches it
+    std::vector<row_t> benchmark_run(core::game_data& data, core::thread_pool& pool, const options_t& options,
+                                     const std::string& map, const size_t run)
+    {
+        auto rows = std::vector<row_t>();
+        const auto add_row = [&](std::string stage, const milliseconds start, const milliseconds duration) {
+            rows.push_back({.map = map,
+                            .run = std::to_string(run),
+                            .stage = std::move(stage),
+                            .start = start,
+                            .duration = duration,
+                            .value = {}});
+        };
+
+        data.cache.purge_level();
+
+        auto renderer = std::optional<rndr::system>();
+        const auto texture_setup = measure([&] { renderer.emplace(data, pool); });
+        add_row("texture_setup", {}, texture_setup);
+
+        auto timings = game::load_timings();
+        auto level = game::level_t();
+        const auto load = measure(
+            [&] { level = game::load_level(data, *renderer, pool, map, game::sky_texture_name(map), &timings); });
+
+        for (const auto& stage : timings)
+            add_row(stage.name, texture_setup + stage.start, stage.duration);
+
+        add_row("load_level", texture_setup, load);
+
+        if (!options.level_cache_dir.empty())
+        {
+            // the cache file name depends on the wads, all files of the map are removed for the cold load
+            for (const auto& entry : std::filesystem::directory_iterator(options.level_cache_dir))
+            {
+                if (entry.path().filename().string().starts_with(map + "-")) std::filesystem::remove(entry.path());
+            }
+
+            const auto level_cache = game::level_cache(options.level_cache_dir, pool);
+            const auto sky_name = game::sky_texture_name(map);
+            const auto cold = measure([&] { static_cast<void>(level_cache.load(data, *renderer, map, sky_name)); });
+            const auto warm = measure([&] { static_cast<void>(level_cache.load(data, *renderer, map, sky_name)); });
+            add_row("level_cache_cold", {}, cold);
+            add_row("level_cache_warm", {}, warm);
+        }
+
+        auto stats = rndr::system::precache_stats();
+        const auto precache = measure([&] { stats = renderer->precache_level(level, data); });
+        add_row("precache", texture_setup + load, precache);
+        add_row("total", {}, texture_setup + load + precache);
+
+        const auto add_count = [&](std::string stage, const size_t value) {
+            rows.push_back({.map = map,
+                            .run = std::to_string(run),
+                            .stage = std::move(stage),
+                            .start = {},
+                            .duration = {},
+                            .value = value});
+        };
+        add_count("num_textures", stats.num_textures);
+        add_count("texture_bytes", stats.texture_bytes);
+        add_count("num_flats", stats.num_flats);
+        add_count("flat_bytes", stats.flat_bytes);
+
+        data.cache.release_evicted();
+        return rows;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        const auto options = parse_options(std::span(argv, static_cast<size_t>(argc)).subspan(1));
+
+        core::game_data data;
+        if (options.wads.empty())
+            core::add_wad_file(core::find_iwad().first, data);
+        else
+            core::add_wad_files(options.wads, data);
+
+        auto pool = core::thread_pool(options.threads);
+        if (!options.level_cache_dir.empty()) std::filesystem::create_directories(options.level_cache_dir);
+
+        const auto csv =
+            std::unique_ptr<FILE, decltype(&fclose)>(fopen(options.csv.string().c_str(), "w"), &fclose);
+        if (!csv) throw std::runtime_error(fmt::format("Failed to open '{}'", options.csv.string()));
+
+        fmt::print(csv.get(), "map,run,stage,start_ms,duration_ms,value\n");
+
+        // the mean of every stage over the runs of each map, summed over all maps
+        auto totals = std::map<std::string, milliseconds>();
+        auto stage_order = std::vector<std::string>();
+
+        // a broken map doesn't keep the other maps from being measured
+        auto num_failed = 0;
+        for (const auto& map : map_names(data))
+        {
+            try
+            {
+                for (size_t run = 0; run < options.runs; ++run)
+                {
+                    for (const auto& row : benchmark_run(data, pool, options, map, run))
+                    {
+                        print(csv.get(), row);
+                        if (row.value) continue;
+
+                        if (!totals.contains(row.stage)) stage_order.push_back(row.stage);
+
+                        totals[row.stage] += row.duration / static_cast<double>(options.runs);
+                    }
+                }
+            }
+            catch (const std::exception& e)
+            {
+                fmt::print(stderr, "{}: {}\n", map, e.what());
+                ++num_failed;
+            }
+        }
+
+        for (const auto& stage : stage_order)
+        {
+            print(csv.get(),
+                  {.map = "all", .run = "mean", .stage = stage, .start = {}, .duration = totals[stage], .value = {}});
+        }
+
+        fmt::print("Wrote the timings of {} runs to {}\n", options.runs, options.csv.string());
+
+        return (num_failed == 0) ? 0 : 1;
+    }
+    catch (const std::exception& e)
+    {
+        fmt::print(stderr, "{}\n", e.what());
+        return 1;
+    }
+}